@@ -0,0 +1,92 @@
+# Everything but main.cpp, shared by the application and the benchmarks
+# (benchmarks/benchmarks.pro).
+
+QT       += core gui serialport multimedia network concurrent
+
+greaterThan(QT_MAJOR_VERSION, 5): QT += widgets
+
+
+# You can make your code fail to compile if it uses deprecated APIs.
+# In order to do so, uncomment the following line.
+#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+# Hot path latency histograms and the stats overlay.
+# Comment out to compile the instrumentation out completely.
+DEFINES += RICHARDUINO_PERF
+
+# shm_open for the shared memory stream
+unix:!macx: LIBS += -lrt
+
+# The DSP kernels (dspkernels.h, firfilter, masktest) rely on the
+# auto-vectoriser, which GCC only runs on them from -O3, and which needs
+# -fno-trapping-math to turn their clamps and selects into blends.
+# MSVC vectorises at /O2.
+!msvc {
+    QMAKE_CXXFLAGS_RELEASE -= -O2
+    QMAKE_CXXFLAGS_RELEASE += -O3 -fno-trapping-math
+}
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/acquisitionmodes.cpp \
+    $$PWD/amplitudehistogram.cpp \
+    $$PWD/autoset.cpp \
+    $$PWD/capturefile.cpp \
+    $$PWD/commands.cpp \
+    $$PWD/eyediagram.cpp \
+    $$PWD/fft.cpp \
+    $$PWD/firfilter.cpp \
+    $$PWD/firmwareupdater.cpp \
+    $$PWD/headless.cpp \
+    $$PWD/logsink.cpp \
+    $$PWD/mainwindow.cpp \
+    $$PWD/masktest.cpp \
+    $$PWD/mathchannel.cpp \
+    $$PWD/memorybrowser.cpp \
+    $$PWD/perfstats.cpp \
+    $$PWD/portwatcher.cpp \
+    $$PWD/referencelibrary.cpp \
+    $$PWD/registerwatch.cpp \
+    $$PWD/remoteserver.cpp \
+    $$PWD/rollview.cpp \
+    $$PWD/samplesource.cpp \
+    $$PWD/sharedstream.cpp \
+    $$PWD/sincinterpolator.cpp \
+    $$PWD/spectrogram.cpp \
+    $$PWD/waveformexporter.cpp
+
+HEADERS += \
+    $$PWD/acquisitionmodes.h \
+    $$PWD/amplitudehistogram.h \
+    $$PWD/autoset.h \
+    $$PWD/capturefile.h \
+    $$PWD/commands.h \
+    $$PWD/dspkernels.h \
+    $$PWD/eyediagram.h \
+    $$PWD/fft.h \
+    $$PWD/firfilter.h \
+    $$PWD/firmwareupdater.h \
+    $$PWD/frameparser.h \
+    $$PWD/headless.h \
+    $$PWD/logsink.h \
+    $$PWD/mainwindow.h \
+    $$PWD/masktest.h \
+    $$PWD/mathchannel.h \
+    $$PWD/memorybrowser.h \
+    $$PWD/perfstats.h \
+    $$PWD/portwatcher.h \
+    $$PWD/referencelibrary.h \
+    $$PWD/registerwatch.h \
+    $$PWD/remoteserver.h \
+    $$PWD/rollview.h \
+    $$PWD/samplesource.h \
+    $$PWD/sharedstream.h \
+    $$PWD/sincinterpolator.h \
+    $$PWD/spectrogram.h \
+    $$PWD/streamreader/richarduino_stream.h \
+    $$PWD/triggerslicer.h \
+    $$PWD/waveformexporter.h
+
+FORMS += \
+    $$PWD/mainwindow.ui
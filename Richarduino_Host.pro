@@ -1,25 +1,7 @@
-QT       += core gui serialport multimedia
-
-greaterThan(QT_MAJOR_VERSION, 5): QT += widgets
-
-
-# You can make your code fail to compile if it uses deprecated APIs.
-# In order to do so, uncomment the following line.
-#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+include(Richarduino_Host.pri)
 
 SOURCES += \
-    commands.cpp \
-    firmwareupdater.cpp \
-    main.cpp \
-    mainwindow.cpp
-
-HEADERS += \
-    commands.h \
-    firmwareupdater.h \
-    mainwindow.h
-
-FORMS += \
-    mainwindow.ui
+    main.cpp
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
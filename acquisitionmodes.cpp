@@ -0,0 +1,166 @@
+//******** acquisitionmodes.cpp
+#include "acquisitionmodes.h"
+#include <algorithm>
+#include <cstring>
+
+// SSE2 is part of every x86-64 target, NEON of every AArch64 one; other
+// targets take the scalar loops
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RICHARDUINO_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define RICHARDUINO_NEON
+#endif
+
+// sum[i] += in[i] - out[i], 16 positions a step
+static void accumulate(qint32 *sum, const qint8 *in, const qint8 *out, int count) {
+    int i = 0;
+#if defined(RICHARDUINO_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(out + i));
+        // to 16 bit by unpacking with the sign, the difference fits
+        const __m128i aSign = _mm_cmpgt_epi8(zero, a);
+        const __m128i bSign = _mm_cmpgt_epi8(zero, b);
+        const __m128i low = _mm_sub_epi16(_mm_unpacklo_epi8(a, aSign), _mm_unpacklo_epi8(b, bSign));
+        const __m128i high = _mm_sub_epi16(_mm_unpackhi_epi8(a, aSign), _mm_unpackhi_epi8(b, bSign));
+        // and to 32 bit: each half paired with itself, shifted back down
+        const __m128i d[4] = {_mm_srai_epi32(_mm_unpacklo_epi16(low, low), 16), _mm_srai_epi32(_mm_unpackhi_epi16(low, low), 16),
+                              _mm_srai_epi32(_mm_unpacklo_epi16(high, high), 16), _mm_srai_epi32(_mm_unpackhi_epi16(high, high), 16)};
+        for (int k = 0; k < 4; ++k) {
+            __m128i *s = reinterpret_cast<__m128i *>(sum + i + 4 * k);
+            _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), d[k]));
+        }
+    }
+#elif defined(RICHARDUINO_NEON)
+    for (; i + 16 <= count; i += 16) {
+        const int8x16_t a = vld1q_s8(in + i);
+        const int8x16_t b = vld1q_s8(out + i);
+        const int16x8_t low = vsubl_s8(vget_low_s8(a), vget_low_s8(b));
+        const int16x8_t high = vsubl_s8(vget_high_s8(a), vget_high_s8(b));
+        vst1q_s32(sum + i, vaddw_s16(vld1q_s32(sum + i), vget_low_s16(low)));
+        vst1q_s32(sum + i + 4, vaddw_s16(vld1q_s32(sum + i + 4), vget_high_s16(low)));
+        vst1q_s32(sum + i + 8, vaddw_s16(vld1q_s32(sum + i + 8), vget_low_s16(high)));
+        vst1q_s32(sum + i + 12, vaddw_s16(vld1q_s32(sum + i + 12), vget_high_s16(high)));
+    }
+#endif
+    for (; i < count; ++i) {
+        sum[i] += static_cast<qint32>(in[i]) - out[i];
+    }
+}
+
+// the sum of count codes, 16 (then 8) a step
+static qint32 sumCodes(const qint8 *in, int count) {
+    qint32 total = 0;
+    int i = 0;
+#if defined(RICHARDUINO_SSE2)
+    // psadbw adds unsigned bytes, so the codes are offset by 128 first and
+    // the offset taken off the total
+    const __m128i bias = _mm_set1_epi8(static_cast<char>(0x80));
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)), bias);
+        acc = _mm_add_epi32(acc, _mm_sad_epu8(v, zero));
+    }
+    if (i + 8 <= count) {
+        // only the low half is loaded, and only it is offset
+        const __m128i v = _mm_xor_si128(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(in + i)), _mm_unpacklo_epi64(bias, zero));
+        acc = _mm_add_epi32(acc, _mm_sad_epu8(v, zero));
+        i += 8;
+    }
+    total = _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8)) - 128 * i;
+#elif defined(RICHARDUINO_NEON)
+    int32x4_t acc = vdupq_n_s32(0);
+    for (; i + 16 <= count; i += 16) {
+        acc = vpadalq_s16(acc, vpaddlq_s8(vld1q_s8(in + i)));
+    }
+    const int64x2_t pairs = vpaddlq_s32(acc);
+    total = static_cast<qint32>(vgetq_lane_s64(pairs, 0) + vgetq_lane_s64(pairs, 1));
+#endif
+    for (; i < count; ++i) {
+        total += in[i];
+    }
+    return total;
+}
+
+// --------------------------------------------- AVERAGE
+
+void FrameAverager::configure(int frameLength, int depth) {
+    length = std::max(frameLength, 1);
+    frames = std::max(depth, 1);
+    ring.assign(static_cast<size_t>(length) * frames, 0);
+    sums.assign(length, 0);
+    reset();
+}
+
+void FrameAverager::reset() {
+    std::fill(sums.begin(), sums.end(), 0);
+    next = 0;
+    filled = 0;
+}
+
+void FrameAverager::add(const qint8 *frame) {
+    qint8 *slot = ring.data() + static_cast<size_t>(next) * length;
+    qint32 *sum = sums.data();
+
+    // the slot holds the oldest frame once the ring is full, zeros before
+    accumulate(sum, frame, slot, length);
+    memcpy(slot, frame, length);
+
+    next = next + 1 == frames ? 0 : next + 1;
+    filled = std::min(filled + 1, frames);
+}
+
+void FrameAverager::average(double *out) const {
+    const double scale = filled > 0 ? 1.0 / filled : 0.0;
+    for (int i = 0; i < length; ++i) {
+        out[i] = sums[i] * scale;
+    }
+}
+
+// --------------------------------------------- HIGH RESOLUTION
+
+void BoxcarDecimator::configure(int factor, int fractionBits) {
+    m = std::max(factor, 1);
+    shift = std::max(fractionBits, 0);
+    reset();
+}
+
+void BoxcarDecimator::reset() {
+    sum = 0;
+    phase = 0;
+}
+
+void BoxcarDecimator::process(const qint8 *in, int count, QVector<qint16> &out) {
+    int i = 0;
+
+    // finish the sum a previous call left open
+    for (; phase > 0 && i < count; ++i) {
+        sum += in[i];
+        if (++phase == m) {
+            const qint32 scaled = sum * (1 << shift);
+            out.append(static_cast<qint16>((scaled + (scaled < 0 ? -m / 2 : m / 2)) / m));
+            sum = 0;
+            phase = 0;
+        }
+    }
+
+    // whole groups, written in place
+    const int groups = (count - i) / m;
+    const qsizetype first = out.size();
+    out.resize(first + groups);
+    qint16 *dst = out.data() + first;
+    for (int g = 0; g < groups; ++g, i += m) {
+        const qint32 scaled = sumCodes(in + i, m) * (1 << shift);
+        dst[g] = static_cast<qint16>((scaled + (scaled < 0 ? -m / 2 : m / 2)) / m);
+    }
+
+    // the rest opens the next sum
+    for (; i < count; ++i) {
+        sum += in[i];
+        phase++;
+    }
+}
@@ -0,0 +1,63 @@
+//******** acquisitionmodes.h
+#ifndef ACQUISITIONMODES_H
+#define ACQUISITIONMODES_H
+
+#include <QVector>
+#include <QtGlobal>
+#include <vector>
+
+enum class AcquisitionMode {Normal, Average, HighResolution};
+
+// Running average of the last depth triggered frames. The frames sit in a
+// ring of 8 bit codes next to one int32 sum per sample position, so adding
+// a frame is a single pass that adds it and subtracts the one it replaces,
+// 16 positions per SSE2 or NEON step, and memory stays at
+// depth * frameLength bytes plus the sums however long it runs.
+class FrameAverager {
+public:
+    void configure(int frameLength, int depth);
+    void reset();
+
+    void add(const qint8 *frame);
+
+    int frameLength() const { return length; }
+    int depth() const { return frames; }
+    // frames in the average, up to depth()
+    int count() const { return filled; }
+
+    // the average in ADC codes, with the fraction the averaging gained
+    void average(double *out) const;
+
+private:
+    int length = 0;
+    int frames = 1;
+    std::vector<qint8> ring;
+    std::vector<qint32> sums;
+    int next = 0;
+    int filled = 0;
+};
+
+// High resolution acquisition: every factor consecutive samples are summed
+// into one, which lowers the rate by factor and, with noise to dither the
+// input, adds half a bit of resolution per doubling. Outputs keep that
+// gain as fractionBits bits below the ADC's least significant bit. Groups
+// are summed 16 codes per SIMD step, and the state between calls is one
+// partial sum.
+class BoxcarDecimator {
+public:
+    void configure(int factor, int fractionBits);
+    void reset();
+
+    int factor() const { return m; }
+
+    // appends one output per factor inputs
+    void process(const qint8 *in, int count, QVector<qint16> &out);
+
+private:
+    int m = 1;
+    int shift = 0;
+    qint32 sum = 0;
+    int phase = 0; // inputs in sum
+};
+
+#endif // ACQUISITIONMODES_H
@@ -0,0 +1,157 @@
+//******** amplitudehistogram.cpp
+#include "amplitudehistogram.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Counting into one table stalls whenever neighbouring samples hit the same
+// bin, each increment waits for the previous store. Four tables take turns
+// so a run of equal values is four independent chains, and are summed into
+// the bins once per call. 32 bit lanes are flushed before they can wrap.
+static constexpr int kLanes = 4;
+static constexpr qint64 kChunk = qint64(1) << 30;
+
+void AmplitudeHistogram::tally(const qint8 *samples, qint64 count, bool subtract) {
+    quint32 lanes[kLanes][kBins];
+
+    while (count > 0) {
+        const qint64 chunk = std::min(count, kChunk);
+        std::memset(lanes, 0, sizeof(lanes));
+
+        const quint8 *in = reinterpret_cast<const quint8 *>(samples);
+        qint64 i = 0;
+        for (; i + kLanes <= chunk; i += kLanes) {
+            // + 128 as a byte is the flip of the sign bit
+            lanes[0][in[i] ^ 0x80]++;
+            lanes[1][in[i + 1] ^ 0x80]++;
+            lanes[2][in[i + 2] ^ 0x80]++;
+            lanes[3][in[i + 3] ^ 0x80]++;
+        }
+        for (; i < chunk; ++i) {
+            lanes[0][in[i] ^ 0x80]++;
+        }
+
+        for (int b = 0; b < kBins; ++b) {
+            const quint64 sum = quint64(lanes[0][b]) + lanes[1][b] + lanes[2][b] + lanes[3][b];
+            bins[b] = subtract ? bins[b] - sum : bins[b] + sum;
+        }
+        total = subtract ? total - chunk : total + chunk;
+
+        samples += chunk;
+        count -= chunk;
+    }
+}
+
+// --------------------------------------------- WINDOW
+
+void AmplitudeHistogram::setWindow(qint64 samples) {
+    windowSize = std::max<qint64>(0, samples);
+    ring.assign(static_cast<size_t>(windowSize), 0);
+    ring.shrink_to_fit();
+    reset();
+}
+
+void AmplitudeHistogram::reset() {
+    std::fill(std::begin(bins), std::end(bins), 0);
+    total = 0;
+    head = 0;
+    filled = 0;
+}
+
+void AmplitudeHistogram::add(const qint8 *samples, qint64 count) {
+    if (count <= 0) {
+        return;
+    }
+    if (windowSize == 0) {
+        tally(samples, count, false);
+        return;
+    }
+
+    // only the newest window samples can survive this call
+    if (count >= windowSize) {
+        reset();
+        samples += count - windowSize;
+        count = windowSize;
+    }
+
+    // take the oldest samples out of the bins before they are overwritten
+    const qint64 excess = filled + count - windowSize;
+    if (excess > 0) {
+        const qint64 oldest = (head + windowSize - filled) % windowSize;
+        const qint64 firstPart = std::min(excess, windowSize - oldest);
+        tally(ring.data() + oldest, firstPart, true);
+        tally(ring.data(), excess - firstPart, true);
+        filled -= excess;
+    }
+
+    const qint64 firstPart = std::min(count, windowSize - head);
+    std::memcpy(ring.data() + head, samples, static_cast<size_t>(firstPart));
+    std::memcpy(ring.data(), samples + firstPart, static_cast<size_t>(count - firstPart));
+    head = (head + count) % windowSize;
+    filled += count;
+
+    tally(samples, count, false);
+}
+
+// --------------------------------------------- STATISTICS
+
+quint64 AmplitudeHistogram::largestBin() const {
+    return *std::max_element(std::begin(bins), std::end(bins));
+}
+
+int AmplitudeHistogram::minimum() const {
+    for (int b = 0; b < kBins; ++b) {
+        if (bins[b]) {
+            return b - 128;
+        }
+    }
+    return 0;
+}
+
+int AmplitudeHistogram::maximum() const {
+    for (int b = kBins - 1; b >= 0; --b) {
+        if (bins[b]) {
+            return b - 128;
+        }
+    }
+    return 0;
+}
+
+double AmplitudeHistogram::mean() const {
+    if (total == 0) {
+        return 0.0;
+    }
+    double sum = 0.0;
+    for (int b = 0; b < kBins; ++b) {
+        sum += static_cast<double>(bins[b]) * (b - 128);
+    }
+    return sum / total;
+}
+
+double AmplitudeHistogram::standardDeviation() const {
+    if (total < 2) {
+        return 0.0;
+    }
+    const double m = mean();
+    double sum = 0.0;
+    for (int b = 0; b < kBins; ++b) {
+        const double d = (b - 128) - m;
+        sum += static_cast<double>(bins[b]) * d * d;
+    }
+    return std::sqrt(sum / (total - 1));
+}
+
+int AmplitudeHistogram::percentile(double fraction) const {
+    if (total == 0) {
+        return 0;
+    }
+    const double target = std::clamp(fraction, 0.0, 1.0) * total;
+    quint64 cumulative = 0;
+    for (int b = 0; b < kBins; ++b) {
+        cumulative += bins[b];
+        if (cumulative > 0 && cumulative >= target) {
+            return b - 128;
+        }
+    }
+    return maximum();
+}
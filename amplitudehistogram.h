@@ -0,0 +1,48 @@
+//******** amplitudehistogram.h
+#ifndef AMPLITUDEHISTOGRAM_H
+#define AMPLITUDEHISTOGRAM_H
+
+#include <QtGlobal>
+#include <vector>
+
+// Distribution of the signed 8 bit samples, one bin per value. Samples are
+// counted as they arrive and every statistic is computed from the 256 bins,
+// so a readout costs the same after a billion samples as after ten.
+// With a window only the last window samples count: they are kept in a
+// ring, and the ones that fall out are subtracted from the bins.
+class AmplitudeHistogram {
+public:
+    static constexpr int kBins = 256;
+
+    // 0 counts the whole session
+    void setWindow(qint64 samples);
+    qint64 window() const { return windowSize; }
+    void reset();
+
+    void add(const qint8 *samples, qint64 count);
+
+    quint64 count() const { return total; }
+    // value is the sample, -128 to 127
+    quint64 bin(int value) const { return bins[value + 128]; }
+    quint64 largestBin() const;
+
+    int minimum() const;
+    int maximum() const;
+    double mean() const;
+    double standardDeviation() const;
+    // smallest value with at least fraction of the samples at or below it
+    int percentile(double fraction) const;
+
+private:
+    void tally(const qint8 *samples, qint64 count, bool subtract);
+
+    quint64 bins[kBins] = {};
+    quint64 total = 0;
+
+    qint64 windowSize = 0;
+    std::vector<qint8> ring;
+    qint64 head = 0;   // next write position
+    qint64 filled = 0;
+};
+
+#endif // AMPLITUDEHISTOGRAM_H
@@ -0,0 +1,142 @@
+//******** autoset.cpp
+#include "autoset.h"
+#include "fft.h"
+#include <cmath>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+// autocorrelation peaks weaker than this are treated as "no period"
+static constexpr double kMinCorrelation = 0.3;
+
+// Period from the spacing of rising crossings through the DC level, with
+// hysteresis so noise around the level does not count as extra crossings
+static double crossingPeriod(const qint8 *samples, int count, double level, double hysteresis) {
+    bool armed = false;
+    int first = -1;
+    int last = -1;
+    int crossings = 0;
+
+    for (int i = 0; i < count; ++i) {
+        const double value = samples[i];
+        if (value < level - hysteresis) {
+            armed = true;
+        } else if (armed && value > level + hysteresis) {
+            armed = false;
+            if (first < 0) {
+                first = i;
+            } else {
+                last = i;
+                crossings++;
+            }
+        }
+    }
+
+    return crossings > 0 ? static_cast<double>(last - first) / crossings : 0.0;
+}
+
+// Period from the first strong peak of the autocorrelation, computed as the
+// inverse FFT of the power spectrum
+static double autocorrelationPeriod(const qint8 *samples, int count, double mean) {
+    const int size = Fft::nextPowerOfTwo(2 * count);
+
+    // the GUI calls this with the same window size every time, keep the plan
+    static std::unique_ptr<Fft> fft;
+    if (!fft || fft->size() != size) {
+        fft.reset(new Fft(size));
+    }
+
+    std::vector<Complex> buffer(size);
+    for (int i = 0; i < count; ++i) {
+        buffer[i] = Complex(static_cast<float>(samples[i] - mean), 0.0f);
+    }
+
+    fft->forward(buffer.data());
+    for (Complex &bin : buffer) {
+        bin = Complex(std::norm(bin), 0.0f);
+    }
+    fft->inverse(buffer.data());
+
+    const double r0 = buffer[0].real();
+    if (r0 <= 0) {
+        return 0.0;
+    }
+
+    // unbiased and normalised, r[0] == 1
+    const int maxLag = count / 2;
+    std::vector<double> r(maxLag + 1);
+    for (int k = 0; k <= maxLag; ++k) {
+        r[k] = buffer[k].real() / r0 * count / (count - k);
+    }
+
+    // skip the central lobe, then take the first peak close to the strongest one
+    int lag = 1;
+    while (lag < maxLag && r[lag] > 0) {
+        lag++;
+    }
+    if (lag >= maxLag) {
+        return 0.0;
+    }
+
+    double strongest = 0.0;
+    for (int k = lag; k < maxLag; ++k) {
+        strongest = std::max(strongest, r[k]);
+    }
+    if (strongest < kMinCorrelation) {
+        return 0.0;
+    }
+
+    for (int k = std::max(lag, 1); k < maxLag; ++k) {
+        if (r[k] >= 0.9 * strongest && r[k] >= r[k - 1] && r[k] >= r[k + 1]) {
+            // parabolic interpolation around the peak for a sub sample period
+            const double denominator = r[k - 1] - 2.0 * r[k] + r[k + 1];
+            const double delta = denominator != 0.0 ? 0.5 * (r[k - 1] - r[k + 1]) / denominator : 0.0;
+            return k + delta;
+        }
+    }
+    return 0.0;
+}
+
+SignalEstimate estimateSignal(const qint8 *samples, int count) {
+    SignalEstimate estimate;
+    if (count < 16) {
+        return estimate;
+    }
+
+    // 1 ----------------------------- levels ----------------------------
+    int minimum = 127;
+    int maximum = -128;
+    qint64 sum = 0;
+    for (int i = 0; i < count; ++i) {
+        minimum = std::min<int>(minimum, samples[i]);
+        maximum = std::max<int>(maximum, samples[i]);
+        sum += samples[i];
+    }
+    estimate.minimum = minimum;
+    estimate.maximum = maximum;
+    estimate.offset = static_cast<double>(sum) / count;
+    estimate.amplitude = std::max(maximum - estimate.offset, estimate.offset - minimum);
+
+    // 2 ----------------------------- noise ----------------------------
+    // median absolute second difference, which cancels the slope of the
+    // signal itself and is robust against its edges
+    int histogram[256] = {};
+    for (int i = 2; i < count; ++i) {
+        histogram[std::min(255, std::abs(samples[i] - 2 * samples[i - 1] + samples[i - 2]))]++;
+    }
+    int seen = 0;
+    int median = 0;
+    while (median < 255 && (seen += histogram[median]) < (count - 2) / 2) {
+        median++;
+    }
+    estimate.noise = median / 0.6745 / std::sqrt(6.0);
+
+    // 3 ----------------------------- period ----------------------------
+    const double correlated = autocorrelationPeriod(samples, count, estimate.offset);
+    const double crossed = crossingPeriod(samples, count, estimate.offset,
+                                          std::max(estimate.amplitude * 0.1, 2.0 * estimate.noise));
+    estimate.period = correlated > 0 ? correlated : crossed;
+
+    estimate.valid = maximum > minimum;
+    return estimate;
+}
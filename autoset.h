@@ -0,0 +1,24 @@
+//******** autoset.h
+#ifndef AUTOSET_H
+#define AUTOSET_H
+
+#include <QtGlobal>
+
+// What Autoset learned about the signal, in ADC codes and samples
+struct SignalEstimate {
+    bool valid = false;
+    double minimum = 0.0;
+    double maximum = 0.0;
+    double offset = 0.0;     // DC level
+    double amplitude = 0.0;  // largest excursion from the DC level
+    double period = 0.0;     // fundamental period in samples, 0 when none was found
+    double noise = 0.0;      // standard deviation of the sample to sample noise
+};
+
+// Estimates level, amplitude, period and noise of a block of raw samples.
+// The period comes from an FFT based autocorrelation, cross checked with
+// the mean crossing rate. Runs in well under a millisecond for the 8K
+// sample window the GUI uses.
+SignalEstimate estimateSignal(const qint8 *samples, int count);
+
+#endif // AUTOSET_H
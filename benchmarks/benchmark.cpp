@@ -0,0 +1,311 @@
+//******** benchmark.cpp
+#include "mainwindow.h"
+#include "ui_mainwindow.h"
+#include "firmwareupdater.h"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMap>
+#include <QTextStream>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+// Times the acquisition and rendering hot paths on synthetic data and
+// compares the medians with a stored baseline. Runs offscreen, so a
+// headless CI box needs no display:
+//
+//   richarduino_benchmarks --save-baseline baseline.txt     record
+//   richarduino_benchmarks --baseline baseline.txt          check, exit 1 on a regression
+
+static constexpr double kDefaultTolerance = 0.25; // slower than the baseline by more than this fails
+static constexpr int kDefaultMinTimeMs = 200;      // per case, after warming up
+static constexpr int kWarmupRuns = 5;
+
+// Hands out the same prepared block on every readAll(), what Sampling()
+// would see from a board that always has exactly that much waiting.
+class BlockSampleSource : public SampleSource {
+public:
+    explicit BlockSampleSource(const QByteArray &block) : block(block) {}
+
+    bool start() override { return true; }
+    void stop() override {}
+    QByteArray readAll() override { return block; }
+    quint32 sampleRate() const override { return kSerialSampleRate; }
+    QString name() const override { return "benchmark"; }
+
+private:
+    QByteArray block;
+};
+
+// a sine of a few periods with a little noise, as ADC codes
+static QByteArray syntheticSamples(int count) {
+    QByteArray samples(count, 0);
+    quint32 noise = 12345;
+    for (int i = 0; i < count; ++i) {
+        noise = noise * 1664525u + 1013904223u;
+        const double value = 90.0 * std::sin(2.0 * M_PI * i / 97.0) + static_cast<int>(noise >> 29) - 4;
+        samples[i] = static_cast<char>(qBound(-128, static_cast<int>(std::lround(value)), 127));
+    }
+    return samples;
+}
+
+struct Result {
+    QString name;
+    qint64 items = 0;   // processed per run, for the throughput
+    int runs = 0;
+    double median = 0.0; // ns per run
+    double p99 = 0.0;
+};
+
+class Benchmarks {
+public:
+    Benchmarks(MainWindow &window, int minTimeMs, const QString &filter)
+        : window(window), minTimeMs(minTimeMs), filter(filter) {}
+
+    void sampling();
+    void smoothing();
+    void drawing();
+    void rolling();
+    void bytesExtractor();
+
+    const QVector<Result> &results() const { return all; }
+
+private:
+    template <typename Run>
+    void measure(const QString &name, qint64 items, Run &&run);
+
+    MainWindow &window;
+    int minTimeMs;
+    QString filter;
+    QVector<Result> all;
+};
+
+template <typename Run>
+void Benchmarks::measure(const QString &name, qint64 items, Run &&run) {
+    if (!name.contains(filter)) {
+        return;
+    }
+    for (int i = 0; i < kWarmupRuns; ++i) {
+        run();
+    }
+
+    QVector<qint64> times;
+    QElapsedTimer total;
+    QElapsedTimer one;
+    total.start();
+    while (total.elapsed() < minTimeMs || times.size() < 10) {
+        one.start();
+        run();
+        times.append(one.nsecsElapsed());
+    }
+    std::sort(times.begin(), times.end());
+
+    Result result;
+    result.name = name;
+    result.items = items;
+    result.runs = times.size();
+    result.median = times[times.size() / 2];
+    result.p99 = times[std::min<qsizetype>(times.size() - 1, times.size() * 99 / 100)];
+    all.append(result);
+
+    std::printf("%-36s %8d runs %12.0f ns %12.0f ns p99 %10.2f M/s\n", qPrintable(name), result.runs, result.median,
+                result.p99, items * 1e3 / result.median);
+    std::fflush(stdout);
+}
+
+// --------------------------------------------- CASES
+
+void Benchmarks::sampling() {
+    for (int block : {256, 4096, 65536}) {
+        BlockSampleSource source(syntheticSamples(block));
+        window.sampleSource = &source;
+        window.framedStream = false;
+        measure(QString("Sampling/raw/%1").arg(block), block, [this]() {
+            window.Sampling();
+            // updateWaveforms() would trim these every frame
+            if (window.sampledData.channel1.size() > (1 << 20)) {
+                window.sampledData.channel1.clear();
+            }
+            if (window.recentSamples.size() > (1 << 20)) {
+                window.recentSamples.clear();
+            }
+        });
+        window.sampleSource = nullptr;
+    }
+}
+
+void Benchmarks::smoothing() {
+    for (int size : {512, 4096, 65536}) {
+        const QByteArray samples = syntheticSamples(size);
+        window.currentBuffer.channel1.resize(size);
+        dsp::widen(reinterpret_cast<const qint8 *>(samples.constData()), size, kSampleFractionBits, window.currentBuffer.channel1.data());
+        window.currentBuffer.channel2.clear();
+        for (int smoothWindow : {1, 9}) {
+            measure(QString("smoothWaveformData/%1/w%2").arg(size).arg(smoothWindow), size,
+                    [this, smoothWindow]() { window.smoothWaveformData(smoothWindow); });
+        }
+    }
+}
+
+void Benchmarks::drawing() {
+    QLabel *label = window.ui->sineWaveLabel;
+    window.ui->lockingCheckBox->setChecked(true);
+    window.ui->lockingLevelSlider->setValue(0);
+
+    for (QSize labelSize : {QSize(640, 240), QSize(1920, 540)}) {
+        label->setMinimumSize(labelSize);
+        label->setMaximumSize(labelSize);
+        label->resize(labelSize);
+        for (int size : {512, 4096, 65536}) {
+            const QByteArray samples = syntheticSamples(size);
+            QVector<double> data(size);
+            dsp::convert(reinterpret_cast<const qint8 *>(samples.constData()), size, data.data());
+            const FrameSettings settings = window.frameSettings();
+            measure(QString("drawWaveform/%1x%2/%3").arg(labelSize.width()).arg(labelSize.height()).arg(size), size,
+                    [this, label, &data, &settings]() { window.drawWaveform(label, data, settings); });
+        }
+    }
+}
+
+// a roll frame: the samples that arrived since the last one, then the
+// scroll and the new columns, so the cost should follow the block size
+void Benchmarks::rolling() {
+    QLabel *label = window.ui->sineWaveLabel;
+    const QSize labelSize(1920, 540);
+    label->setMinimumSize(labelSize);
+    label->setMaximumSize(labelSize);
+    label->resize(labelSize);
+    window.ui->rollCheckBox->setChecked(true);
+    window.ui->rollSpanSpinBox->setValue(60.0);
+
+    for (int block : {256, 4096, 65536}) {
+        const QByteArray samples = syntheticSamples(block);
+        const FrameSettings settings = window.frameSettings();
+        measure(QString("drawRoll/%1x%2/%3").arg(labelSize.width()).arg(labelSize.height()).arg(block), block,
+                [this, &samples, &settings]() {
+                    window.appendDisplaySamples(samples.constData(), samples.size());
+                    window.drawRoll(settings);
+                    window.sampledData.channel1.clear();
+                });
+    }
+    window.ui->rollCheckBox->setChecked(false);
+}
+
+void Benchmarks::bytesExtractor() {
+    FirmwareUpdater updater("", "");
+    for (int lines : {1024, 16384}) {
+        // the listing format the updater reads: a header line, then address tab word
+        QString listing = "address\tdata\n";
+        for (int i = 0; i < lines; ++i) {
+            listing += QString("%1\t%2\n").arg(i * 4, 8, 16, QChar('0')).arg(0x12345678u ^ (i * 2654435761u), 8, 16, QChar('0'));
+        }
+        std::vector<unsigned char> programBytes;
+        programBytes.reserve(lines * 4);
+        measure(QString("bytesExtractor/%1").arg(lines), lines, [&]() {
+            QTextStream in(&listing, QIODevice::ReadOnly);
+            programBytes.clear();
+            updater.bytesExtractor(in, programBytes);
+        });
+    }
+}
+
+// --------------------------------------------- BASELINE
+
+// one "name<tab>median ns" per line, # starts a comment
+static QMap<QString, double> readBaseline(const QString &path, bool *ok) {
+    QMap<QString, double> baseline;
+    QFile file(path);
+    *ok = file.open(QIODevice::ReadOnly | QIODevice::Text);
+    if (!*ok) {
+        return baseline;
+    }
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        const QString line = in.readLine().trimmed();
+        const QStringList parts = line.split('\t');
+        if (line.isEmpty() || line.startsWith('#') || parts.size() < 2) {
+            continue;
+        }
+        baseline.insert(parts[0], parts[1].toDouble());
+    }
+    return baseline;
+}
+
+static bool writeBaseline(const QString &path, const QVector<Result> &results) {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        return false;
+    }
+    QTextStream out(&file);
+    out << "# median ns per run, written by richarduino_benchmarks --save-baseline\n";
+    for (const Result &result : results) {
+        out << result.name << '\t' << QString::number(result.median, 'f', 0) << '\n';
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    // no display needed
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Richarduino hot path benchmarks");
+    parser.addHelpOption();
+    QCommandLineOption baselineOption("baseline", "Fail when a case is slower than in <file>.", "file");
+    QCommandLineOption saveOption("save-baseline", "Write this run's medians to <file>.", "file");
+    QCommandLineOption toleranceOption("tolerance", "Allowed slowdown as a fraction, default 0.25.", "fraction",
+                                       QString::number(kDefaultTolerance));
+    QCommandLineOption minTimeOption("min-time", "Time per case in ms, default 200.", "ms", QString::number(kDefaultMinTimeMs));
+    QCommandLineOption filterOption("filter", "Only run cases whose name contains <text>.", "text");
+    parser.addOptions({baselineOption, saveOption, toleranceOption, minTimeOption, filterOption});
+    parser.process(app);
+
+    MainWindow window;
+    Benchmarks benchmarks(window, parser.value(minTimeOption).toInt(), parser.value(filterOption));
+    benchmarks.sampling();
+    benchmarks.smoothing();
+    benchmarks.drawing();
+    benchmarks.rolling();
+    benchmarks.bytesExtractor();
+
+    if (parser.isSet(saveOption)) {
+        if (!writeBaseline(parser.value(saveOption), benchmarks.results())) {
+            std::fprintf(stderr, "ERROR: cannot write %s\n", qPrintable(parser.value(saveOption)));
+            return 2;
+        }
+        std::printf("baseline written to %s\n", qPrintable(parser.value(saveOption)));
+    }
+
+    if (!parser.isSet(baselineOption)) {
+        return 0;
+    }
+    bool ok;
+    const QMap<QString, double> baseline = readBaseline(parser.value(baselineOption), &ok);
+    if (!ok) {
+        std::fprintf(stderr, "ERROR: cannot read %s\n", qPrintable(parser.value(baselineOption)));
+        return 2;
+    }
+
+    const double tolerance = parser.value(toleranceOption).toDouble();
+    int regressions = 0;
+    for (const Result &result : benchmarks.results()) {
+        if (!baseline.contains(result.name)) {
+            std::printf("%-36s no baseline\n", qPrintable(result.name));
+            continue;
+        }
+        const double reference = baseline.value(result.name);
+        const double change = reference > 0 ? result.median / reference - 1.0 : 0.0;
+        const bool regressed = change > tolerance;
+        regressions += regressed;
+        std::printf("%-36s %+7.1f %% %s\n", qPrintable(result.name), change * 100.0, regressed ? "REGRESSION" : "ok");
+    }
+    std::printf("%d regression(s) past %.0f %%\n", regressions, tolerance * 100.0);
+    return regressions > 0 ? 1 : 0;
+}
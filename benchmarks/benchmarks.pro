@@ -0,0 +1,19 @@
+# Hot path benchmarks, a separate target built against the application
+# sources. Runs offscreen; exits 1 when a case regresses past the baseline.
+#
+# Build it in its own directory, its Makefile and objects would overwrite
+# the application's in the source tree:
+#
+#   mkdir build-bench && cd build-bench
+#   qmake ../benchmarks/benchmarks.pro && make
+#   ./richarduino_benchmarks --baseline baseline.txt
+
+include(../Richarduino_Host.pri)
+
+TEMPLATE = app
+TARGET = richarduino_benchmarks
+CONFIG += console
+CONFIG -= app_bundle
+
+SOURCES += \
+    benchmark.cpp
@@ -0,0 +1,76 @@
+//******** capturefile.cpp
+#include "capturefile.h"
+#include <QtEndian>
+#include <cstring>
+
+CaptureWriter::~CaptureWriter() {
+    close();
+}
+
+bool CaptureWriter::open(const QString &path, quint32 sampleRate, quint16 channelCount) {
+    close();
+    file.setFileName(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+
+    uchar header[kCaptureHeaderSize] = {'R', 'C', 'A', 'P'};
+    qToLittleEndian<quint16>(kCaptureVersion, header + 4);
+    qToLittleEndian<quint16>(channelCount, header + 6);
+    qToLittleEndian<quint32>(sampleRate, header + 8);
+    qToLittleEndian<quint32>(0, header + 12);
+    file.write(reinterpret_cast<const char *>(header), kCaptureHeaderSize);
+
+    samplesWritten = 0;
+    return true;
+}
+
+void CaptureWriter::write(const char *samples, qint64 count) {
+    if (!file.isOpen() || count <= 0) {
+        return;
+    }
+    samplesWritten += file.write(samples, count);
+}
+
+void CaptureWriter::close() {
+    if (file.isOpen()) {
+        file.close();
+    }
+}
+
+bool CaptureReader::open(const QString &path) {
+    file.close();
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        return false;
+    }
+
+    uchar header[kCaptureHeaderSize];
+    if (file.read(reinterpret_cast<char *>(header), kCaptureHeaderSize) != kCaptureHeaderSize
+        || memcmp(header, "RCAP", 4) != 0) {
+        error = "not a capture file";
+        file.close();
+        return false;
+    }
+
+    if (qFromLittleEndian<quint16>(header + 4) != kCaptureVersion) {
+        error = "unsupported capture version";
+        file.close();
+        return false;
+    }
+
+    channels = qFromLittleEndian<quint16>(header + 6);
+    rate = qFromLittleEndian<quint32>(header + 8);
+    samples = file.size() - kCaptureHeaderSize;
+    error.clear();
+    return channels > 0;
+}
+
+qint64 CaptureReader::read(char *dst, qint64 maxSamples) {
+    return std::max<qint64>(0, file.read(dst, maxSamples));
+}
+
+bool CaptureReader::seek(qint64 sample) {
+    return file.seek(kCaptureHeaderSize + sample);
+}
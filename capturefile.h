@@ -0,0 +1,66 @@
+//******** capturefile.h
+#ifndef CAPTUREFILE_H
+#define CAPTUREFILE_H
+
+#include <QFile>
+#include <QString>
+
+// The serial link runs at 921600 baud with 10 bits on the wire per byte,
+// so this is the highest rate the board can stream 8 bit samples at.
+constexpr quint32 kSerialSampleRate = 921600 / 10;
+
+// Recorded captures (*.rcap) are a 16 byte little endian header followed by
+// the raw signed 8 bit samples exactly as they came off the wire,
+// interleaved when there is more than one channel.
+//
+//   offset  size  field
+//   0       4     magic "RCAP"
+//   4       2     version (1)
+//   6       2     channel count
+//   8       4     sample rate in Hz
+//   12      4     reserved (0)
+constexpr int kCaptureHeaderSize = 16;
+constexpr quint16 kCaptureVersion = 1;
+
+class CaptureWriter {
+public:
+    ~CaptureWriter();
+
+    bool open(const QString &path, quint32 sampleRate, quint16 channelCount = 1);
+    void write(const char *samples, qint64 count);
+    void write(const QByteArray &samples) { write(samples.constData(), samples.size()); }
+    void close();
+
+    bool isOpen() const { return file.isOpen(); }
+    qint64 sampleCount() const { return samplesWritten; }
+    QString fileName() const { return file.fileName(); }
+    QString errorString() const { return file.errorString(); }
+
+private:
+    QFile file;
+    qint64 samplesWritten = 0;
+};
+
+class CaptureReader {
+public:
+    bool open(const QString &path);
+    void close() { file.close(); }
+
+    // reads up to maxSamples samples into dst, returns how many were read
+    qint64 read(char *dst, qint64 maxSamples);
+    bool seek(qint64 sample);
+
+    quint32 sampleRate() const { return rate; }
+    quint16 channelCount() const { return channels; }
+    qint64 sampleCount() const { return samples; }
+    QString errorString() const { return error; }
+
+private:
+    QFile file;
+    quint32 rate = 0;
+    quint16 channels = 0;
+    qint64 samples = 0;
+    QString error;
+};
+
+#endif // CAPTUREFILE_H
@@ -30,6 +30,19 @@ void Poke::execute(uint32_t address, uint32_t data) {
     serial->flush();
 }
 
+void Poke::executeBatch(const QVector<uint32_t> &addresses, const QVector<uint32_t> &data) {
+    QByteArray message;
+    message.reserve(addresses.size() * 9);
+    for (int i = 0; i < addresses.size() && i < data.size(); ++i) {
+        message.append('W');
+        message.append(uint32ToBigEndian(addresses[i]));
+        message.append(uint32ToBigEndian(data[i]));
+    }
+
+    serial->write(message);
+    serial->flush();
+}
+
 
 QByteArray Peek::execute(uint32_t address) {
     QByteArray message;
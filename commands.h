@@ -5,12 +5,15 @@
 
 #include <QObject>
 #include <QSerialPort>
+#include <QVector>
 
 class Poke : public QObject {
     Q_OBJECT
 public:
     explicit Poke(QSerialPort *serial, QObject *parent = nullptr);
     void execute(uint32_t address, uint32_t data);
+    // all writes go out in one serial write
+    void executeBatch(const QVector<uint32_t> &addresses, const QVector<uint32_t> &data);
 
 private:
     QSerialPort *serial;
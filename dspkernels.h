@@ -0,0 +1,246 @@
+//******** dspkernels.h
+#ifndef DSPKERNELS_H
+#define DSPKERNELS_H
+
+#include <QtGlobal>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+// Processing kernels shared by the acquisition and display paths, templated
+// on the sample type so the hot loops run on the raw 8 or 16 bit codes with
+// integer accumulators, and floating point appears only where a trace is
+// handed to the display. A wider ADC only needs a wider sample type, not
+// new kernels.
+//
+// The loops are written for the auto-vectoriser, which Richarduino_Host.pri
+// turns on for GCC and Clang release builds (-O3 -fno-trapping-math, GCC
+// leaves these loops scalar at -O2; MSVC vectorises at /O2). With GCC 12 on
+// the x86-64 SSE2 baseline every kernel here vectorises except the running
+// sum of boxAverage, minMax and markEdges on doubles; the exceptions are
+// noted where they are.
+namespace dsp {
+
+// Accumulator holds a short running sum (a smoothing window), Total the
+// sum over a whole buffer
+template <typename T>
+struct SampleTraits;
+
+template <>
+struct SampleTraits<qint8> {
+    using Accumulator = qint32;
+    using Total = qint64;
+};
+
+template <>
+struct SampleTraits<qint16> {
+    using Accumulator = qint32;
+    using Total = qint64;
+};
+
+template <>
+struct SampleTraits<float> {
+    using Accumulator = double;
+    using Total = double;
+};
+
+template <>
+struct SampleTraits<double> {
+    using Accumulator = double;
+    using Total = double;
+};
+
+// Integer targets are saturated and rounded to the nearest code, halves
+// away from zero. Clamp, copysign and a truncating convert are all SSE2
+// operations, where nearbyint would need SSE4.1 and keep the loop scalar.
+template <typename Out, typename In>
+inline Out sampleCast(In value) {
+    if constexpr (std::is_integral_v<Out> && std::is_floating_point_v<In>) {
+        constexpr In lowest = static_cast<In>(std::numeric_limits<Out>::min());
+        constexpr In highest = static_cast<In>(std::numeric_limits<Out>::max());
+        value = value < lowest ? lowest : value;
+        value = value > highest ? highest : value;
+        return static_cast<Out>(value + std::copysign(static_cast<In>(0.5), value));
+    } else {
+        return static_cast<Out>(value);
+    }
+}
+
+template <typename In, typename Out>
+void convert(const In *in, qsizetype count, Out *out) {
+    for (qsizetype i = 0; i < count; ++i) {
+        out[i] = sampleCast<Out>(in[i]);
+    }
+}
+
+// integer codes to a wider integer type with shift fraction bits below them
+template <typename In, typename Out>
+void widen(const In *in, qsizetype count, int shift, Out *out) {
+    const Out factor = static_cast<Out>(1 << shift);
+    for (qsizetype i = 0; i < count; ++i) {
+        out[i] = static_cast<Out>(in[i]) * factor;
+    }
+}
+
+// Centred moving average over window samples (made odd), the window
+// shrinking at both ends so every output averages real samples only. One
+// add and one subtract per sample whatever the window, the running sum
+// stays in the sample type's accumulator. Outputs are multiplied by gain.
+template <typename T, typename Out>
+void boxAverage(const T *in, qsizetype count, int window, Out *out, double gain = 1.0) {
+    using Accumulator = typename SampleTraits<T>::Accumulator;
+    const qsizetype half = std::max(window, 1) / 2;
+    if (count <= 0) {
+        return;
+    }
+    if (half == 0) {
+        for (qsizetype i = 0; i < count; ++i) {
+            out[i] = sampleCast<Out>(in[i] * gain);
+        }
+        return;
+    }
+
+    // the window around i is [i - half, i + half] clipped to the buffer
+    Accumulator sum = 0;
+    qsizetype end = 0; // one past the last sample in the sum
+    for (; end < std::min(half, count); ++end) {
+        sum += in[end];
+    }
+    for (qsizetype i = 0; i < count; ++i) {
+        if (end < count) {
+            sum += in[end++];
+        }
+        const qsizetype first = i - half;
+        if (first > 0) {
+            sum -= in[first - 1];
+        }
+        const qsizetype n = end - std::max<qsizetype>(first, 0);
+        out[i] = sampleCast<Out>(static_cast<double>(sum) * gain / n);
+    }
+}
+
+// mean of |x[i] - x[i - 1]|, how rough the trace is
+template <typename T>
+double meanAbsDifference(const T *in, qsizetype count) {
+    using Accumulator = typename SampleTraits<T>::Accumulator;
+    using Total = typename SampleTraits<T>::Total;
+    if (count < 2) {
+        return 0.0;
+    }
+
+    // blocks short enough that the accumulator cannot overflow on 16 bit
+    // codes, summed into the wide total between them
+    constexpr qsizetype kBlock = 16384;
+    Total total = 0;
+    for (qsizetype start = 1; start < count; start += kBlock) {
+        const qsizetype stop = std::min(start + kBlock, count);
+        Accumulator sum = 0;
+        for (qsizetype i = start; i < stop; ++i) {
+            const Accumulator d = static_cast<Accumulator>(in[i]) - static_cast<Accumulator>(in[i - 1]);
+            sum += d < 0 ? -d : d;
+        }
+        total += sum;
+    }
+    return static_cast<double>(total) / (count - 1);
+}
+
+// doubles stay scalar, a floating min/max reduction may only be reordered
+// with -ffinite-math-only
+template <typename T>
+void minMax(const T *in, qsizetype count, T &minimum, T &maximum) {
+    if (count <= 0) {
+        minimum = maximum = T();
+        return;
+    }
+    T lo = in[0];
+    T hi = in[0];
+    for (qsizetype i = 1; i < count; ++i) {
+        lo = in[i] < lo ? in[i] : lo;
+        hi = in[i] > hi ? in[i] : hi;
+    }
+    minimum = lo;
+    maximum = hi;
+}
+
+// Whether any |x| reaches level. Blocks are scanned whole without an early
+// exit and the answer is checked between them. Codes take the block's peak;
+// floating samples only remember a hit, since a max over doubles is the
+// reduction the vectoriser will not reorder.
+template <typename T>
+bool anyAbsAtLeast(const T *in, qsizetype count, double level) {
+    using Accumulator = typename SampleTraits<T>::Accumulator;
+    constexpr qsizetype kBlock = 256;
+    for (qsizetype start = 0; start < count; start += kBlock) {
+        const qsizetype stop = std::min(start + kBlock, count);
+        if constexpr (std::is_floating_point_v<T>) {
+            Accumulator hit = 0;
+            for (qsizetype i = start; i < stop; ++i) {
+                hit = std::fabs(in[i]) >= level ? 1 : hit;
+            }
+            if (hit != 0) {
+                return true;
+            }
+        } else {
+            Accumulator peak = 0;
+            for (qsizetype i = start; i < stop; ++i) {
+                const Accumulator v = in[i] < 0 ? -static_cast<Accumulator>(in[i]) : static_cast<Accumulator>(in[i]);
+                peak = v > peak ? v : peak;
+            }
+            if (peak >= level) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// out[i] = in[i] * gain + offset, samples to pixel rows for one
+template <typename T, typename Out>
+void scale(const T *in, qsizetype count, double gain, double offset, Out *out) {
+    for (qsizetype i = 0; i < count; ++i) {
+        out[i] = sampleCast<Out>(in[i] * gain + offset);
+    }
+}
+
+// Rising and Falling mark a sample whose successor is higher or lower,
+// Lock a step down that lands above level, what the locking trigger
+// aligns on.
+enum class Edge {Rising, Falling, Lock};
+
+// Sets flags[i] to 1 where sample i is an edge of kind E and to 0
+// elsewhere, count flags in all. One compare per sample and no branches;
+// the instantiation per kind keeps the mode out of the loop, and whoever
+// draws markers walks the flags afterwards. Codes vectorise, doubles only
+// where the target can narrow a double compare to bytes (SSE4.1, NEON).
+template <Edge E, typename T>
+void markEdges(const T *in, qsizetype count, double level, quint8 *flags) {
+    if (count <= 0) {
+        return;
+    }
+    if constexpr (E == Edge::Lock) {
+        flags[0] = 0;
+        for (qsizetype i = 1; i < count; ++i) {
+            flags[i] = static_cast<quint8>((in[i] < in[i - 1]) & (in[i] > level));
+        }
+    } else {
+        for (qsizetype i = 0; i + 1 < count; ++i) {
+            if constexpr (E == Edge::Rising) {
+                flags[i] = static_cast<quint8>(in[i] < in[i + 1]);
+            } else {
+                flags[i] = static_cast<quint8>(in[i] > in[i + 1]);
+            }
+        }
+        flags[count - 1] = 0;
+    }
+}
+
+// first set flag in [from, count), -1 when there is none
+inline qsizetype firstFlag(const quint8 *flags, qsizetype from, qsizetype count) {
+    const quint8 *hit = std::find(flags + std::max<qsizetype>(from, 0), flags + count, 1);
+    return hit == flags + count ? -1 : hit - flags;
+}
+
+} // namespace dsp
+
+#endif // DSPKERNELS_H
@@ -0,0 +1,146 @@
+//******** eyediagram.cpp
+#include "eyediagram.h"
+#include <algorithm>
+#include <cmath>
+
+// loop gains per edge, the integral path moves the clock frequency
+static constexpr double kProportionalGain = 1.0 / 16;
+static constexpr double kIntegralGain = 1.0 / 1024;
+
+// the recovered clock may be this far off the nominal one
+static constexpr double kMaxFrequencyError = 0.2;
+
+// mean absolute edge error below which the loop counts as locked, in UI
+static constexpr double kLockError = 0.1;
+
+void EyeDiagram::configure(double samplesPerUi) {
+    nominal = std::max(samplesPerUi, 2.0);
+    kp = kProportionalGain;
+    ki = kIntegralGain;
+    reset();
+}
+
+void EyeDiagram::reset() {
+    period = nominal;
+    phase = 0.0;
+    errorAverage = 1.0;
+    locked = false;
+    std::fill(grid.begin(), grid.end(), 0);
+    peakHits = 0;
+    samples = 0;
+}
+
+void EyeDiagram::feed(const qint8 *in, int count) {
+    const double nominalStep = 1.0 / nominal;
+    double step = 1.0 / period;
+    const double hysteresis = (high - low) / 8;
+
+    for (int i = 0; i < count; ++i) {
+        const int v = in[i];
+
+        // 1 ----------------------------- clock ----------------------------
+        phase += step;
+        if (phase >= 2.0) {
+            phase -= 2.0;
+        }
+
+        if (above ? v < level - hysteresis : v > level + hysteresis) {
+            above = !above;
+
+            // where between the last two samples the level was crossed
+            const double t = v != previous ? std::clamp((level - previous) / (v - previous), 0.0, 1.0) : 1.0;
+            double error = phase - (1.0 - t) * step - 0.5;
+            error -= std::floor(error + 0.5); // nearest crossing slot
+
+            phase -= kp * error;
+            if (phase < 0.0) {
+                phase += 2.0;
+            }
+            step = std::clamp(step - ki * error * nominalStep,
+                              nominalStep * (1.0 - kMaxFrequencyError), nominalStep * (1.0 + kMaxFrequencyError));
+
+            errorAverage += (std::abs(error) - errorAverage) / 64;
+            locked = errorAverage < kLockError;
+        }
+
+        // 2 ----------------------------- threshold ----------------------------
+        if (v > level) {
+            high += (v - high) / 256;
+        } else {
+            low += (v - low) / 256;
+        }
+        level = (high + low) / 2;
+
+        // 3 ----------------------------- fold ----------------------------
+        // nothing is counted while the loop is still pulling in
+        previous = v;
+        if (!locked) {
+            continue;
+        }
+        const int column = std::min(static_cast<int>(phase * (kColumns / 2)), kColumns - 1);
+        quint32 &cell = grid[(127 - v) * kColumns + column];
+        cell++;
+        peakHits = std::max(peakHits, cell);
+        samples++;
+    }
+
+    period = 1.0 / step;
+}
+
+// --------------------------------------------- MEASURE
+
+EyeDiagram::Measurement EyeDiagram::measure() const {
+    Measurement m;
+    if (samples == 0) {
+        return m;
+    }
+
+    // the eye centre is a few columns either side of 1 UI
+    const int centre = kColumns / 2;
+    const int span = 2;
+    auto rowHit = [&](int row) {
+        for (int c = centre - span; c <= centre + span; ++c) {
+            if (grid[row * kColumns + c]) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    const int thresholdRow = std::clamp(127 - static_cast<int>(std::lround(level)), 0, kRows - 1);
+    if (rowHit(thresholdRow)) {
+        return m;
+    }
+
+    int top = thresholdRow;
+    while (top > 0 && !rowHit(top - 1)) {
+        top--;
+    }
+    int bottom = thresholdRow;
+    while (bottom < kRows - 1 && !rowHit(bottom + 1)) {
+        bottom++;
+    }
+
+    // and the same across, one row either side of the threshold
+    auto columnHit = [&](int column) {
+        for (int r = std::max(thresholdRow - 1, 0); r <= std::min(thresholdRow + 1, kRows - 1); ++r) {
+            if (grid[r * kColumns + column]) {
+                return true;
+            }
+        }
+        return false;
+    };
+    int left = centre;
+    while (left > 0 && !columnHit(left - 1)) {
+        left--;
+    }
+    int right = centre;
+    while (right < kColumns - 1 && !columnHit(right + 1)) {
+        right++;
+    }
+
+    m.open = true;
+    m.height = bottom - top + 1;
+    m.width = (right - left + 1) / static_cast<double>(kColumns / 2);
+    return m;
+}
@@ -0,0 +1,69 @@
+//******** eyediagram.h
+#ifndef EYEDIAGRAM_H
+#define EYEDIAGRAM_H
+
+#include <QtGlobal>
+#include <vector>
+
+// Eye diagram of a serial data signal. The symbol clock is recovered from
+// the data itself: a phase accumulator advances one unit interval every
+// samplesPerUi samples, and each threshold crossing, located between two
+// samples by interpolation, pulls its phase and period towards the edge
+// through a proportional plus integral loop. Every sample is then folded
+// into a two UI window at its recovered phase and counted in a density
+// grid, kColumns across the two UI by one row per 8 bit level.
+// The decision threshold follows the signal on its own, halfway between
+// the averages of the high and the low samples.
+class EyeDiagram {
+public:
+    static constexpr int kColumns = 256;
+    static constexpr int kRows = 256;
+
+    struct Measurement {
+        bool open = false;
+        int height = 0;      // levels free of hits at the eye centre
+        double width = 0.0;  // UI free of hits at the threshold
+    };
+
+    void configure(double samplesPerUi);
+    void reset();
+
+    void feed(const qint8 *samples, int count);
+
+    // hits per cell, row 0 is level 127, column 0 is half an UI before the
+    // first crossing
+    const std::vector<quint32> &density() const { return grid; }
+    quint32 peak() const { return peakHits; }
+    // samples folded in so far, only those taken while locked
+    quint64 sampleCount() const { return samples; }
+
+    // the recovered unit interval in samples, and whether the loop follows
+    // the edges closely enough to trust it
+    double unitInterval() const { return period; }
+    bool isLocked() const { return locked; }
+    int threshold() const { return static_cast<int>(level); }
+
+    Measurement measure() const;
+
+private:
+    double nominal = 16.0;
+    double period = 16.0;
+    double phase = 0.0;  // 0 to 2 UI, crossings belong at 0.5 and 1.5
+    double kp = 0.0;
+    double ki = 0.0;
+
+    double level = 0.0;
+    double high = 32.0;
+    double low = -32.0;
+    bool above = false;
+    int previous = 0;
+
+    double errorAverage = 1.0; // mean absolute phase error, in UI
+    bool locked = false;
+
+    std::vector<quint32> grid = std::vector<quint32>(kColumns * kRows, 0);
+    quint32 peakHits = 0;
+    quint64 samples = 0;
+};
+
+#endif // EYEDIAGRAM_H
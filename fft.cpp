@@ -0,0 +1,57 @@
+//******** fft.cpp
+#include "fft.h"
+#include <cmath>
+#include <utility>
+
+Fft::Fft(int size) : n(size), twiddles(size / 2), bitReversed(size) {
+    const double pi = std::acos(-1.0);
+    for (int k = 0; k < n / 2; ++k) {
+        twiddles[k] = Complex(static_cast<float>(std::cos(2.0 * pi * k / n)),
+                              static_cast<float>(-std::sin(2.0 * pi * k / n)));
+    }
+
+    int bits = 0;
+    while ((1 << bits) < n) {
+        bits++;
+    }
+    for (int i = 0; i < n; ++i) {
+        int reversed = 0;
+        for (int b = 0; b < bits; ++b) {
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        bitReversed[i] = reversed;
+    }
+}
+
+int Fft::nextPowerOfTwo(int value) {
+    int size = 1;
+    while (size < value) {
+        size <<= 1;
+    }
+    return size;
+}
+
+void Fft::transform(Complex *data, bool inverse) const {
+    for (int i = 0; i < n; ++i) {
+        if (i < bitReversed[i]) {
+            std::swap(data[i], data[bitReversed[i]]);
+        }
+    }
+
+    for (int length = 2; length <= n; length <<= 1) {
+        const int half = length / 2;
+        const int stride = n / length;
+        for (int start = 0; start < n; start += length) {
+            for (int k = 0; k < half; ++k) {
+                const Complex w = twiddles[k * stride];
+                const float wr = w.real();
+                const float wi = inverse ? -w.imag() : w.imag();
+                const Complex b = data[start + k + half];
+                // spelled out, std::complex operator* goes through the slow NaN checking path
+                const Complex odd(b.real() * wr - b.imag() * wi, b.real() * wi + b.imag() * wr);
+                data[start + k + half] = data[start + k] - odd;
+                data[start + k] += odd;
+            }
+        }
+    }
+}
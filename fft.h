@@ -0,0 +1,33 @@
+//******** fft.h
+#ifndef FFT_H
+#define FFT_H
+
+#include <complex>
+#include <vector>
+
+using Complex = std::complex<float>;
+
+// In place radix 2 FFT of a fixed power of two size. Twiddles and the bit
+// reversal table are built once, so an instance is meant to be kept around
+// and reused for every block of the same size.
+class Fft {
+public:
+    explicit Fft(int size);
+
+    int size() const { return n; }
+
+    void forward(Complex *data) const { transform(data, false); }
+    // unnormalised, divide by size() to get the original signal back
+    void inverse(Complex *data) const { transform(data, true); }
+
+    static int nextPowerOfTwo(int value);
+
+private:
+    void transform(Complex *data, bool inverse) const;
+
+    int n;
+    std::vector<Complex> twiddles;
+    std::vector<int> bitReversed;
+};
+
+#endif // FFT_H
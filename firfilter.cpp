@@ -0,0 +1,213 @@
+//******** firfilter.cpp
+#include "firfilter.h"
+#include <algorithm>
+#include <cmath>
+
+// Dot product of two contiguous float ranges. Eight independent partial
+// sums let the compiler keep them in one SIMD register without having to
+// reorder a single float sum, which it may not do on its own.
+static inline float dot(const float *a, const float *b, int count) {
+    float lanes[8] = {};
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        for (int j = 0; j < 8; ++j) {
+            lanes[j] += a[i + j] * b[i + j];
+        }
+    }
+    float sum = ((lanes[0] + lanes[4]) + (lanes[1] + lanes[5])) + ((lanes[2] + lanes[6]) + (lanes[3] + lanes[7]));
+    for (; i < count; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+// --------------------------------------------- DESIGN
+
+static std::vector<double> lowPass(int taps, double cutoff, FirFilter::Window window) {
+    const double pi = std::acos(-1.0);
+    const double centre = (taps - 1) / 2.0;
+    std::vector<double> h(taps);
+    double sum = 0.0;
+    for (int n = 0; n < taps; ++n) {
+        const double x = n - centre;
+        const double sinc = x == 0.0 ? 2.0 * cutoff : std::sin(2.0 * pi * cutoff * x) / (pi * x);
+        const double phase = 2.0 * pi * n / (taps - 1);
+        double w = 1.0;
+        switch (window) {
+        case FirFilter::Window::Hamming:
+            w = 0.54 - 0.46 * std::cos(phase);
+            break;
+        case FirFilter::Window::Blackman:
+            w = 0.42 - 0.5 * std::cos(phase) + 0.08 * std::cos(2.0 * phase);
+            break;
+        case FirFilter::Window::Hann:
+            w = 0.5 - 0.5 * std::cos(phase);
+            break;
+        }
+        h[n] = sinc * w;
+        sum += h[n];
+    }
+    // unity gain at DC
+    for (double &v : h) {
+        v /= sum;
+    }
+    return h;
+}
+
+std::vector<float> FirFilter::design(Type type, int taps, double low, double high, Window window) {
+    taps = std::max(taps, 3) | 1;
+    low = std::clamp(low, 1e-6, 0.5);
+    high = std::clamp(high, 1e-6, 0.5);
+    const int centre = taps / 2;
+
+    std::vector<double> h;
+    switch (type) {
+    case Type::LowPass:
+        h = lowPass(taps, high, window);
+        break;
+    case Type::HighPass:
+        // spectral inversion of the low pass
+        h = lowPass(taps, low, window);
+        for (double &v : h) {
+            v = -v;
+        }
+        h[centre] += 1.0;
+        break;
+    case Type::BandPass:
+    case Type::BandStop: {
+        const std::vector<double> upper = lowPass(taps, std::max(low, high), window);
+        const std::vector<double> lower = lowPass(taps, std::min(low, high), window);
+        h.resize(taps);
+        for (int n = 0; n < taps; ++n) {
+            h[n] = upper[n] - lower[n];
+        }
+        if (type == Type::BandStop) {
+            for (double &v : h) {
+                v = -v;
+            }
+            h[centre] += 1.0;
+        }
+        break;
+    }
+    }
+    return std::vector<float>(h.begin(), h.end());
+}
+
+// --------------------------------------------- FILTER
+
+void FirFilter::setTaps(const std::vector<float> &taps) {
+    reversed.assign(taps.rbegin(), taps.rend());
+    if (reversed.empty()) {
+        reversed.push_back(1.0f);
+    }
+    const int m = tapCount();
+
+    fft.reset();
+    if (m > kDirectMaxTaps) {
+        // blocks of at least three times the kernel keep the overlap cheap
+        const int size = Fft::nextPowerOfTwo(4 * m);
+        fft.reset(new Fft(size));
+        response.assign(size, Complex(0.0f, 0.0f));
+        for (int i = 0; i < m; ++i) {
+            response[i] = Complex(taps[i] / size, 0.0f); // 1 / size of the inverse folded in
+        }
+        fft->forward(response.data());
+        work.resize(size);
+    }
+    reset();
+}
+
+void FirFilter::reset() {
+    history.assign(std::max(tapCount() - 1, 0), 0.0f);
+    if (fft) {
+        block.assign(fft->size(), 0.0f);
+        blockFill = tapCount() - 1;
+    }
+}
+
+void FirFilter::process(const float *in, int count, std::vector<float> &out) {
+    const int m = tapCount();
+
+    if (fft) {
+        while (count > 0) {
+            const int take = std::min(count, fft->size() - blockFill);
+            std::copy(in, in + take, block.begin() + blockFill);
+            blockFill += take;
+            in += take;
+            count -= take;
+            if (blockFill == fft->size()) {
+                processBlock(out);
+            }
+        }
+        return;
+    }
+
+    // history followed by the new inputs, each output reads m of them
+    history.insert(history.end(), in, in + count);
+    const size_t first = out.size();
+    out.resize(first + count);
+    float *dst = out.data() + first;
+    const float *taps = reversed.data();
+    for (int i = 0; i < count; ++i) {
+        dst[i] = dot(taps, history.data() + i, m);
+    }
+    history.erase(history.begin(), history.end() - (m - 1));
+}
+
+void FirFilter::processBlock(std::vector<float> &out) {
+    const int size = fft->size();
+    const int overlap = tapCount() - 1;
+
+    for (int i = 0; i < size; ++i) {
+        work[i] = Complex(block[i], 0.0f);
+    }
+    fft->forward(work.data());
+    for (int i = 0; i < size; ++i) {
+        const Complex a = work[i];
+        const Complex b = response[i];
+        work[i] = Complex(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+    }
+    fft->inverse(work.data());
+
+    // the first overlap outputs are wrapped around, the rest are exact
+    for (int i = overlap; i < size; ++i) {
+        out.push_back(work[i].real());
+    }
+
+    std::copy(block.end() - overlap, block.end(), block.begin());
+    blockFill = overlap;
+}
+
+// --------------------------------------------- DECIMATOR
+
+void FirDecimator::configure(int factor, int tapsPerPhase) {
+    m = std::max(factor, 1);
+    if (m == 1) {
+        reversed.assign(1, 1.0f);
+    } else {
+        // cut a little below the new Nyquist rate
+        const std::vector<float> taps = FirFilter::design(FirFilter::Type::LowPass, m * tapsPerPhase, 0.0, 0.4 / m,
+                                                          FirFilter::Window::Blackman);
+        reversed.assign(taps.rbegin(), taps.rend());
+    }
+    reset();
+}
+
+void FirDecimator::reset() {
+    history.assign(reversed.size() - 1, 0.0f);
+    phase = 0;
+}
+
+void FirDecimator::process(const float *in, int count, std::vector<float> &out) {
+    const int taps = static_cast<int>(reversed.size());
+    history.insert(history.end(), in, in + count);
+
+    // input i ends the window at history[i + taps - 1]
+    int i = m - 1 - phase;
+    for (; i < count; i += m) {
+        out.push_back(dot(reversed.data(), history.data() + i, taps));
+    }
+    phase = (phase + count) % m;
+
+    history.erase(history.begin(), history.end() - (taps - 1));
+}
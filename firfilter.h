@@ -0,0 +1,74 @@
+//******** firfilter.h
+#ifndef FIRFILTER_H
+#define FIRFILTER_H
+
+#include <memory>
+#include <vector>
+#include "fft.h"
+
+// Streaming FIR filter. Short kernels are run directly, one dot product of
+// the reversed taps against the input history per output, summed in eight
+// independent lanes so the float adds can be reordered into SIMD. Above
+// kDirectMaxTaps the filter switches to FFT overlap-save: blocks of the
+// input are transformed, multiplied by the kernel's spectrum and
+// transformed back, so the cost per sample grows with log(taps) instead of
+// taps. Either way every process() call costs the same per sample however
+// it is sliced.
+class FirFilter {
+public:
+    enum class Type {LowPass, HighPass, BandPass, BandStop};
+    enum class Window {Hamming, Blackman, Hann};
+
+    static constexpr int kDirectMaxTaps = 64;
+
+    // windowed sinc, cutoffs as a fraction of the sample rate (0 to 0.5),
+    // low only for high pass, high only for low pass; taps is made odd
+    static std::vector<float> design(Type type, int taps, double low, double high, Window window = Window::Hamming);
+
+    void setTaps(const std::vector<float> &taps);
+    void reset();
+
+    int tapCount() const { return static_cast<int>(reversed.size()); }
+    bool isDirect() const { return !fft; }
+    int fftSize() const { return fft ? fft->size() : 0; }
+
+    // Appends the outputs for count inputs to out. The direct form answers
+    // every input at once; overlap-save holds inputs back until a block is
+    // full, so its outputs trail by up to one block.
+    void process(const float *in, int count, std::vector<float> &out);
+
+private:
+    void processBlock(std::vector<float> &out);
+
+    std::vector<float> reversed; // taps back to front
+    std::vector<float> history;  // the last taps - 1 inputs
+
+    // overlap-save
+    std::unique_ptr<Fft> fft;
+    std::vector<Complex> response;
+    std::vector<Complex> work;
+    std::vector<float> block; // taps - 1 inputs of overlap, then new ones
+    int blockFill = 0;
+};
+
+// Low pass filter and downsampler in one. Only every factor'th output is
+// ever computed, which is what splitting the kernel into factor polyphase
+// branches amounts to, so the cost per input sample is taps / factor.
+class FirDecimator {
+public:
+    void configure(int factor, int tapsPerPhase = 16);
+    void reset();
+
+    int factor() const { return m; }
+
+    // appends one output per factor inputs
+    void process(const float *in, int count, std::vector<float> &out);
+
+private:
+    int m = 1;
+    std::vector<float> reversed;
+    std::vector<float> history;
+    int phase = 0; // inputs since the last output
+};
+
+#endif // FIRFILTER_H
@@ -1,5 +1,5 @@
 //******** firmwareupdater.cpp
-#include "FirmwareUpdater.h"
+#include "firmwareupdater.h"
 #include <QtSerialPort/QSerialPort>
 #include <QtSerialPort/QSerialPortInfo>
 #include <QThread>
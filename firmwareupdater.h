@@ -21,6 +21,8 @@ signals:
     void updateStatus(const QString &status);
 
 private:
+    friend class Benchmarks; // benchmarks/ times bytesExtractor()
+
     QString portName;
     QString firmwarePath;
     int baudRate;
@@ -0,0 +1,154 @@
+//******** frameparser.h
+#ifndef FRAMEPARSER_H
+#define FRAMEPARSER_H
+
+#include <QByteArray>
+#include <QtGlobal>
+#include <algorithm>
+#include <cstring>
+
+// Framed streaming mode. Every frame on the wire is
+//
+//   offset  size  field
+//   0       2     sync word 0xA5 0x5A
+//   2       2     sequence number, little endian, +1 per frame
+//   4       1     channel id (0 = channel 1, 1 = channel 2)
+//   5       1     payload length n in samples
+//   6       n     signed 8 bit samples
+//   6+n     1     checksum, 8 bit sum of the payload bytes
+//
+// Gaps in the sequence number count as lost frames, anything that does
+// not line up with a valid frame is skipped until the next sync word. A
+// sequence that goes back, repeats or jumps further than kMaxSequenceGap
+// is the board starting over rather than frames lost on the way, so it is
+// counted as a sequence jump and tracking restarts from it.
+constexpr uchar kFrameSync0 = 0xA5;
+constexpr uchar kFrameSync1 = 0x5A;
+constexpr int kFrameHeaderSize = 6;
+constexpr int kFrameOverhead = kFrameHeaderSize + 1;
+constexpr int kMaxFrameSize = kFrameOverhead + 255;
+constexpr quint16 kMaxSequenceGap = 256;
+
+class FrameParser {
+public:
+    struct Stats {
+        quint64 frames = 0;
+        quint64 samples = 0;
+        quint64 lostFrames = 0;
+        quint64 sequenceJumps = 0;
+        quint64 resyncs = 0;
+        quint64 discardedBytes = 0;
+        quint64 badChecksums = 0;
+    };
+
+    // Feeds the next chunk of the stream. sink(channel, payload, length) is
+    // called for every complete frame, with payload pointing straight into
+    // the chunk; only a frame split across two chunks gets copied.
+    template <typename Sink>
+    void parse(const QByteArray &chunk, Sink &&sink);
+
+    void reset() {
+        carry.clear();
+        counters = Stats();
+        synced = false;
+        haveSequence = false;
+    }
+    // the next frame starts the sequence afresh, after a gap in the stream
+    void restartSequence() { haveSequence = false; }
+    const Stats &stats() const { return counters; }
+
+private:
+    // returns the bytes consumed from data, stops at an incomplete frame
+    template <typename Sink>
+    qsizetype parseBuffer(const uchar *data, qsizetype size, Sink &sink);
+
+    QByteArray carry;
+    Stats counters;
+    quint16 expectedSequence = 0;
+    bool synced = false;
+    bool haveSequence = false;
+};
+
+template <typename Sink>
+void FrameParser::parse(const QByteArray &chunk, Sink &&sink) {
+    qsizetype offset = 0;
+
+    if (!carry.isEmpty()) {
+        // complete the split frame with just enough of the new chunk,
+        // then go back to parsing the chunk in place
+        const qsizetype before = carry.size();
+        carry.append(chunk.constData(), std::min<qsizetype>(chunk.size(), kMaxFrameSize));
+        const qsizetype used = parseBuffer(reinterpret_cast<const uchar *>(carry.constData()), carry.size(), sink);
+        if (used < before) {
+            carry.remove(0, used);
+            return; // chunk was too short to finish the frame, it is all in carry now
+        }
+        carry.clear();
+        offset = used - before;
+    }
+
+    offset += parseBuffer(reinterpret_cast<const uchar *>(chunk.constData()) + offset, chunk.size() - offset, sink);
+    if (offset < chunk.size()) {
+        carry = chunk.mid(offset);
+    }
+}
+
+template <typename Sink>
+qsizetype FrameParser::parseBuffer(const uchar *data, qsizetype size, Sink &sink) {
+    qsizetype pos = 0;
+    while (size - pos >= kFrameHeaderSize) {
+        const uchar *frame = data + pos;
+        if (frame[0] != kFrameSync0 || frame[1] != kFrameSync1) {
+            // lost alignment, skip to the next candidate sync word
+            if (synced) {
+                counters.resyncs++;
+                synced = false;
+            }
+            const uchar *next = static_cast<const uchar *>(memchr(frame + 1, kFrameSync0, size - pos - 1));
+            const qsizetype skip = next ? next - frame : size - pos;
+            counters.discardedBytes += skip;
+            pos += skip;
+            continue;
+        }
+
+        const int length = frame[5];
+        if (size - pos < kFrameOverhead + length) {
+            break; // rest of the frame is in the next chunk
+        }
+
+        const uchar *payload = frame + kFrameHeaderSize;
+        uchar sum = 0;
+        for (int i = 0; i < length; ++i) {
+            sum += payload[i];
+        }
+        if (sum != payload[length]) {
+            // a sync word inside the sample data, not a real frame
+            counters.badChecksums++;
+            counters.discardedBytes++;
+            synced = false;
+            pos++;
+            continue;
+        }
+
+        const quint16 sequence = static_cast<quint16>(frame[2] | (frame[3] << 8));
+        if (haveSequence) {
+            const quint16 gap = static_cast<quint16>(sequence - expectedSequence);
+            if (gap <= kMaxSequenceGap) {
+                counters.lostFrames += gap;
+            } else {
+                counters.sequenceJumps++;
+            }
+        }
+        expectedSequence = sequence + 1;
+        haveSequence = true;
+        synced = true;
+
+        counters.frames++;
+        counters.samples += length;
+        sink(frame[4], reinterpret_cast<const char *>(payload), length);
+        pos += kFrameOverhead + length;
+    }
+    return pos;
+}
+
+#endif // FRAMEPARSER_H
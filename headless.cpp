@@ -0,0 +1,247 @@
+//******** headless.cpp
+#include "headless.h"
+#include "capturefile.h"
+#include "commands.h"
+#include "firmwareupdater.h"
+#include "frameparser.h"
+#include "samplesource.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QSerialPort>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+#include <cstring>
+#include <cstdio>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#endif
+
+static QTextStream &out() {
+    static QTextStream stream(stdout);
+    return stream;
+}
+
+static QTextStream &err() {
+    static QTextStream stream(stderr);
+    return stream;
+}
+
+static int usage() {
+    err() << "usage:\n"
+             "  Richarduino_Host flash  <port> <firmware file>\n"
+             "  Richarduino_Host script <port> <script file | ->\n"
+             "  Richarduino_Host record <port> <seconds> <capture.rcap> [--framed]\n"
+          << Qt::flush;
+    return 2;
+}
+
+static bool openPort(QSerialPort &serial, const QString &portName) {
+    serial.setPortName(portName);
+    serial.setBaudRate(921600);
+    if (!serial.open(QIODevice::ReadWrite)) {
+        err() << "ERROR: cannot open serial port: " << portName << ". " << serial.errorString() << Qt::endl;
+        return false;
+    }
+    return true;
+}
+
+// same sequence as the Turn On / Turn Off buttons
+static void powerBoard(QSerialPort &serial, bool on) {
+    Poke poke(&serial);
+    poke.execute(0xFFFFFFF4, on ? 0xFFFFFFFF : 0);
+    poke.execute(0xFFFFFFF0, on ? 0xFFFFFFFF : 0);
+}
+
+// same pokes as the Init DMA button: start address and length
+static void initDma(QSerialPort &serial) {
+    Poke poke(&serial);
+    poke.execute(0xFFFFFFBC, 0xFFFFFFE4);
+    poke.execute(0xFFFFFFB8, 1);
+}
+
+// --------------------------------------------- FLASH
+
+static int flash(const QString &portName, const QString &firmwarePath) {
+    QSerialPort serial;
+    if (!openPort(serial, portName)) {
+        return 1;
+    }
+
+    FirmwareUpdater updater(portName, firmwarePath);
+    QObject::connect(&updater, &FirmwareUpdater::updateStatus, [](const QString &status) {
+        out() << status << Qt::endl;
+    });
+    return updater.updateFirmware(serial) ? 0 : 1;
+}
+
+// --------------------------------------------- SCRIPT
+
+static int script(const QString &portName, const QString &scriptPath) {
+    QFile file;
+    bool opened;
+    if (scriptPath == "-") {
+        opened = file.open(stdin, QIODevice::ReadOnly | QIODevice::Text);
+    } else {
+        file.setFileName(scriptPath);
+        opened = file.open(QIODevice::ReadOnly | QIODevice::Text);
+    }
+    if (!opened) {
+        err() << "ERROR: cannot open " << scriptPath << ". " << file.errorString() << Qt::endl;
+        return 1;
+    }
+
+    QSerialPort serial;
+    if (!openPort(serial, portName)) {
+        return 1;
+    }
+
+    QTextStream in(&file);
+    int lineNumber = 0;
+    while (!in.atEnd()) {
+        const QString line = in.readLine().trimmed();
+        lineNumber++;
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+
+        const QStringList parts = line.split(' ', Qt::SkipEmptyParts);
+        const QString command = parts[0].toLower();
+        bool ok = true;
+
+        if (command == "poke" && parts.size() == 3) {
+            bool okData;
+            const uint32_t address = parts[1].toUInt(&ok, 16);
+            const uint32_t data = parts[2].toUInt(&okData, 16);
+            ok = ok && okData;
+            if (ok) {
+                Poke(&serial).execute(address, data);
+            }
+        } else if (command == "peek" && parts.size() == 2) {
+            const uint32_t address = parts[1].toUInt(&ok, 16);
+            if (ok) {
+                const QByteArray response = Peek(&serial).execute(address);
+                if (response.size() < static_cast<int>(sizeof(uint32_t))) {
+                    err() << "ERROR: line " << lineNumber << ": no response from the board" << Qt::endl;
+                    return 1;
+                }
+                uint32_t value;
+                memcpy(&value, response.constData(), sizeof(value));
+                out() << parts[1] << " = 0x" << QString::number(value, 16).toUpper() << " (" << value << ")" << Qt::endl;
+            }
+        } else if (command == "version" && parts.size() == 1) {
+            const QByteArray response = Version(&serial).execute();
+            if (response.isEmpty()) {
+                err() << "ERROR: line " << lineNumber << ": no response from the board" << Qt::endl;
+                return 1;
+            }
+            out() << "Version: " << QString(response[0]) << Qt::endl;
+        } else if (command == "sleep" && parts.size() == 2) {
+            const int ms = parts[1].toInt(&ok);
+            if (ok) {
+                QThread::msleep(ms);
+            }
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            err() << "ERROR: line " << lineNumber << ": cannot parse \"" << line << "\"" << Qt::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// --------------------------------------------- RECORD
+
+// a framed stream is parsed like the GUI does and only channel 1's
+// payloads are written, the same samples a GUI capture holds
+static int record(const QString &portName, double seconds, const QString &path, bool framed) {
+    QSerialPort serial;
+    if (!openPort(serial, portName)) {
+        return 1;
+    }
+
+    CaptureWriter writer;
+    if (!writer.open(path, kSerialSampleRate)) {
+        err() << "ERROR: cannot open " << path << ". " << writer.errorString() << Qt::endl;
+        return 1;
+    }
+
+    powerBoard(serial, true);
+    initDma(serial);
+    SerialSampleSource source(&serial);
+    FrameParser parser;
+    QObject::connect(&source, &SampleSource::readyRead, [&]() {
+        if (!framed) {
+            writer.write(source.readAll());
+            return;
+        }
+        parser.parse(source.readAll(), [&writer](quint8 channel, const char *payload, int length) {
+            if (channel == 0) {
+                writer.write(payload, length);
+            }
+        });
+    });
+    if (!source.start()) {
+        err() << "ERROR: " << source.errorString() << Qt::endl;
+        return 1;
+    }
+
+    QTimer::singleShot(static_cast<int>(seconds * 1000), QCoreApplication::instance(), &QCoreApplication::quit);
+    QCoreApplication::exec();
+
+    source.stop();
+    powerBoard(serial, false);
+    writer.close();
+    out() << "Recorded " << writer.sampleCount() << " samples to " << path << Qt::endl;
+    if (framed) {
+        const FrameParser::Stats &stats = parser.stats();
+        out() << stats.frames << " frames, lost " << stats.lostFrames << ", jumps " << stats.sequenceJumps
+              << ", resyncs " << stats.resyncs << ", bad " << stats.badChecksums << ", skipped " << stats.discardedBytes
+              << " B" << Qt::endl;
+    }
+    return 0;
+}
+
+bool isHeadlessInvocation(int argc, char *argv[]) {
+    if (argc < 2) {
+        return false;
+    }
+    const char *command = argv[1];
+    return strcmp(command, "flash") == 0 || strcmp(command, "script") == 0 || strcmp(command, "record") == 0
+           || strcmp(command, "--help") == 0;
+}
+
+int runHeadless(int argc, char *argv[]) {
+#ifdef Q_OS_WIN
+    // the binary is built for the GUI subsystem, borrow the console of the
+    // shell that started it unless the output is already redirected
+    if (GetFileType(GetStdHandle(STD_OUTPUT_HANDLE)) == FILE_TYPE_UNKNOWN && AttachConsole(ATTACH_PARENT_PROCESS)) {
+        freopen("CONOUT$", "w", stdout);
+        freopen("CONOUT$", "w", stderr);
+    }
+#endif
+
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+    const QString command = args.value(1);
+
+    if (command == "flash" && args.size() == 4) {
+        return flash(args[2], args[3]);
+    }
+    if (command == "script" && args.size() == 4) {
+        return script(args[2], args[3]);
+    }
+    if (command == "record") {
+        const bool framed = args.removeAll("--framed") > 0;
+        bool ok;
+        const double seconds = args.value(3).toDouble(&ok);
+        if (args.size() == 5 && ok && seconds > 0) {
+            return record(args[2], seconds, args[4], framed);
+        }
+    }
+    return usage();
+}
@@ -0,0 +1,21 @@
+//******** headless.h
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+// Command line mode for CI boxes and scripts. Runs on a QCoreApplication,
+// so no widgets, no platform plugin and no display are involved:
+//
+//   Richarduino_Host flash  <port> <firmware file>
+//   Richarduino_Host script <port> <script file | ->
+//   Richarduino_Host record <port> <seconds> <capture.rcap>
+//
+// Script lines are "peek <addr>", "poke <addr> <data>", "version",
+// "sleep <ms>" and "# comments"; addresses and data are hex.
+
+// true when the arguments ask for one of the commands above
+bool isHeadlessInvocation(int argc, char *argv[]);
+
+// process exit code, 0 on success
+int runHeadless(int argc, char *argv[]);
+
+#endif // HEADLESS_H
@@ -0,0 +1,183 @@
+//******** logsink.cpp
+#include "logsink.h"
+#include <QDateTime>
+#include <QFile>
+#include <QPlainTextEdit>
+
+// owns the log file on fileThread, only ever touched through queued calls
+class LogFileWriter : public QObject {
+public:
+    QFile file;
+};
+
+LogSink::LogSink(QObject *parent) : QObject(parent), ring(new Slot[kCapacity]) {
+    for (size_t i = 0; i < static_cast<size_t>(kCapacity); ++i) {
+        ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    connect(&flushTimer, &QTimer::timeout, this, &LogSink::flush);
+    flushTimer.start(kFlushMs);
+}
+
+LogSink::~LogSink() {
+    closeLogFile();
+}
+
+void LogSink::attach(QPlainTextEdit *console) {
+    this->console = console;
+    console->setMaximumBlockCount(kMaxLines);
+}
+
+// --------------------------------------------- RING
+
+// Bounded multi producer ring: a producer claims a position with one CAS
+// on head, fills the slot and publishes it through the slot's sequence;
+// the single consumer reads slots in order as their sequence says ready.
+void LogSink::post(const QString &message, bool timestamp) {
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const size_t mask = kCapacity - 1;
+
+    size_t pos = head.load(std::memory_order_relaxed);
+    for (;;) {
+        Slot &slot = ring[pos & mask];
+        const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        const qptrdiff diff = static_cast<qptrdiff>(sequence) - static_cast<qptrdiff>(pos);
+        if (diff == 0) {
+            if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                slot.time = now;
+                slot.timestamp = timestamp;
+                slot.text = message;
+                slot.sequence.store(pos + 1, std::memory_order_release);
+                return;
+            }
+        } else if (diff < 0) {
+            dropped.fetch_add(1, std::memory_order_relaxed); // full
+            return;
+        } else {
+            pos = head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool LogSink::take(qint64 &time, bool &timestamp, QString &text) {
+    Slot &slot = ring[tail & (kCapacity - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != tail + 1) {
+        return false;
+    }
+    time = slot.time;
+    timestamp = slot.timestamp;
+    text = std::move(slot.text);
+    slot.text = QString();
+    slot.sequence.store(tail + kCapacity, std::memory_order_release);
+    tail++;
+    return true;
+}
+
+// --------------------------------------------- FLUSH
+
+void LogSink::appendLine(QString &batch, qint64 time, bool timestamp, const QString &text) {
+    if (timestamp) {
+        const qint64 minute = time / 60000;
+        if (minute != stampMinute) {
+            stampMinute = minute;
+            stamp = QDateTime::fromMSecsSinceEpoch(time).toString("HH:mm") + ": ";
+        }
+        batch += stamp;
+    }
+    batch += text;
+    batch += '\n';
+}
+
+void LogSink::appendRepeats(QString &batch) {
+    if (repeats > 0) {
+        batch += QString("    last message repeated %1 times\n").arg(repeats);
+        repeats = 0;
+    }
+}
+
+void LogSink::flush() {
+    QString batch;
+    qint64 time;
+    bool timestamp;
+    QString text;
+    bool any = false;
+
+    while (take(time, timestamp, text)) {
+        any = true;
+        if (text == lastText) {
+            repeats++;
+            continue;
+        }
+        appendRepeats(batch);
+        appendLine(batch, time, timestamp, text);
+        lastText = text;
+    }
+    if (!any) {
+        appendRepeats(batch); // a burst of the same message has ended
+    }
+
+    const quint64 lost = dropped.exchange(0, std::memory_order_relaxed);
+    if (lost > 0) {
+        appendRepeats(batch);
+        appendLine(batch, QDateTime::currentMSecsSinceEpoch(), true, QString("%1 log messages dropped").arg(lost));
+        lastText.clear();
+    }
+
+    if (batch.isEmpty()) {
+        return;
+    }
+    batch.chop(1);
+
+    if (console) {
+        console->appendPlainText(batch);
+    }
+    if (fileWriter) {
+        LogFileWriter *writer = fileWriter;
+        const QByteArray data = batch.toUtf8() + '\n';
+        QMetaObject::invokeMethod(writer, [writer, data]() {
+            writer->file.write(data);
+            writer->file.flush();
+        }, Qt::QueuedConnection);
+    }
+}
+
+void LogSink::clear() {
+    if (console) {
+        console->clear();
+    }
+    lastText.clear();
+    repeats = 0;
+}
+
+// --------------------------------------------- FILE
+
+bool LogSink::setLogFile(const QString &path, QString *error) {
+    closeLogFile();
+
+    LogFileWriter *writer = new LogFileWriter;
+    writer->file.setFileName(path);
+    if (!writer->file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        if (error) {
+            *error = writer->file.errorString();
+        }
+        delete writer;
+        return false;
+    }
+
+    writer->moveToThread(&fileThread);
+    fileWriter = writer;
+    fileThread.start();
+    return true;
+}
+
+void LogSink::closeLogFile() {
+    if (!fileWriter) {
+        return;
+    }
+
+    // pending writes run before the thread's event loop exits
+    fileThread.quit();
+    fileThread.wait();
+    delete fileWriter;
+    fileWriter = nullptr;
+}
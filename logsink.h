@@ -0,0 +1,80 @@
+//******** logsink.h
+#ifndef LOGSINK_H
+#define LOGSINK_H
+
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+#include <atomic>
+#include <memory>
+
+class QPlainTextEdit;
+class LogFileWriter;
+
+// Batched log output for logConsole. post() may be called from any thread:
+// it only stamps the time and drops the message into a lock-free ring, it
+// never formats, allocates a widget line or waits. A timer on the GUI
+// thread drains the ring every kFlushMs, collapses runs of the same
+// message into one "repeated N times" line and hands the whole batch to
+// the console in a single append. If the ring is full the message is
+// dropped and counted instead of blocking the caller.
+class LogSink : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int kCapacity = 4096; // power of two
+    static constexpr int kFlushMs = 100;
+    static constexpr int kMaxLines = 5000;
+
+    explicit LogSink(QObject *parent = nullptr);
+    ~LogSink();
+
+    // the console is bounded to kMaxLines, older lines scroll away
+    void attach(QPlainTextEdit *console);
+
+    // thread safe and wait free unless the ring is contended
+    void post(const QString &message, bool timestamp = true);
+
+    // also appends every flushed batch to path, written on a separate thread
+    bool setLogFile(const QString &path, QString *error = nullptr);
+    void closeLogFile();
+
+    void clear();
+
+public slots:
+    void flush();
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        qint64 time;
+        bool timestamp;
+        QString text;
+    };
+
+    bool take(qint64 &time, bool &timestamp, QString &text);
+    void appendLine(QString &batch, qint64 time, bool timestamp, const QString &text);
+    void appendRepeats(QString &batch);
+
+    std::unique_ptr<Slot[]> ring;
+    alignas(64) std::atomic<size_t> head{0}; // producers
+    alignas(64) size_t tail = 0;             // the GUI thread
+    std::atomic<quint64> dropped{0};
+
+    QPlainTextEdit *console = nullptr;
+    QTimer flushTimer;
+
+    // duplicate collapsing, carried across flushes
+    QString lastText;
+    int repeats = 0;
+
+    // formatting "HH:mm" once per minute instead of once per message
+    qint64 stampMinute = -1;
+    QString stamp;
+
+    QThread fileThread;
+    LogFileWriter *fileWriter = nullptr;
+};
+
+#endif // LOGSINK_H
@@ -1,10 +1,16 @@
 //******** main.cpp
 #include "mainwindow.h"
+#include "headless.h"
 
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
+    // command line mode never touches the widget stack
+    if (isHeadlessInvocation(argc, argv)) {
+        return runHeadless(argc, argv);
+    }
+
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
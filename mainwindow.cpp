@@ -5,9 +5,14 @@
 #include <QTimer>
 #include <QPainter>
 #include <firmwareupdater.h>
+#include "waveformexporter.h"
+#include "perfstats.h"
+#include "autoset.h"
+#include <QFile>
+#include <QFileInfo>
 #include <cmath>
 #include <QFileDialog>
-#include <QSerialPortInfo>
+#include <QHeaderView>
 #include <QRegularExpression>
 #include <QValidator>
 #include <QPainterPath>
@@ -20,6 +25,26 @@
 #include <complex>
 #include <cmath>
 
+// raw samples Autoset looks at, a few periods of anything the plot can show
+static constexpr int kAutosetWindow = 8192;
+
+// Auto Track re-runs Autoset this often
+static constexpr int kAutoTrackIntervalMs = 250;
+
+// triggered frames merged into a mask reference by Learn
+static constexpr int kMaskLearnFrames = 16;
+
+// time span of the register watch plot
+static constexpr qint64 kWatchPlotMs = 60000;
+
+// reference overlay colours, reused in order
+static const QColor kReferenceColors[] = {QColor(230, 120, 0), QColor(0, 150, 150), QColor(150, 60, 200),
+                                          QColor(120, 140, 0), QColor(200, 60, 120), QColor(70, 110, 220)};
+static constexpr int kReferenceColorCount = 6;
+
+// columns at the left of the roll plot under its span text, repainted with it
+static constexpr int kRollTextWidth = 120;
+
 /*
 921600
 ------
@@ -33,6 +58,7 @@ MainWindow::MainWindow(QWidget *parent)
     , ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
+    logSink.attach(ui->logConsole);
 
     // ----------------------------------------- LHS -----------------------------------------
 
@@ -40,14 +66,12 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->connectButton, &QPushButton::clicked, this, &MainWindow::initializeSerialCommunication);
     connect(ui->refreshButton, &QPushButton::clicked, this, &MainWindow::onRefreshCOMPorts);
 
-    // fill in the com combobox
-    QList<QSerialPortInfo> ports = QSerialPortInfo::availablePorts();
-    for (const QSerialPortInfo &port : ports) {
-        // Check if the description contains "Standard Serial over Bluetooth link"
-        if (!port.description().contains("Standard Serial over Bluetooth link", Qt::CaseInsensitive)) {
-            ui->comPortComboBox->addItem(port.portName());
-        }
-    }
+    // fill in the com combobox, enumeration runs in the background and the
+    // list follows hotplug events from then on
+    connect(&portWatcher, &PortWatcher::portAdded, this, &MainWindow::onPortAdded);
+    connect(&portWatcher, &PortWatcher::portRemoved, this, &MainWindow::onPortRemoved);
+    connect(&serial, &QSerialPort::errorOccurred, this, &MainWindow::onSerialError);
+    portWatcher.start();
 
     // second row
     connect(ui->browseButton, &QPushButton::clicked, this, &MainWindow::onBrowseFile);
@@ -97,6 +121,7 @@ MainWindow::MainWindow(QWidget *parent)
     // fifth row
     connect(ui->version, &QPushButton::clicked, this, &MainWindow::onVersion);
     connect(ui->clearLog, &QPushButton::clicked, this, &MainWindow::onClear);
+    connect(ui->logFileCheckBox, &QCheckBox::toggled, this, &MainWindow::onLogFileToggled);
     connect(ui->turnonButton, &QPushButton::clicked, this, &MainWindow::turnOnBoard);
     connect(ui->turnOffButton, &QPushButton::clicked, this, &MainWindow::turnOffBoard);
 
@@ -125,7 +150,151 @@ MainWindow::MainWindow(QWidget *parent)
     //    updateTimerInterval();
 
     connect(ui->autoSmoothCheckBox, &QCheckBox::stateChanged, this, &MainWindow::onAutoSmoothChanged);
+    connect(ui->autosetButton, &QPushButton::clicked, this, &MainWindow::onAutoset);
 
+    // math channels are compiled once when edited, not per frame
+    connect(ui->math1Edit, &QLineEdit::editingFinished, this, &MainWindow::onMathChanged);
+    connect(ui->math2Edit, &QLineEdit::editingFinished, this, &MainWindow::onMathChanged);
+
+    // shared memory stream for external tools
+    connect(ui->shareCheckBox, &QCheckBox::toggled, this, &MainWindow::onShareToggled);
+
+    // remote control, the server only comes back to this thread to run commands
+    remoteServer = new RemoteServer(this, [this](const RemoteCommand &command, const RemoteServer::Done &done) {
+        return handleRemoteCommand(command, done);
+    });
+    remoteServer->moveToThread(&remoteThread);
+    connect(&remoteThread, &QThread::finished, remoteServer, &QObject::deleteLater);
+    connect(remoteServer, &RemoteServer::message, this, &MainWindow::logInfo);
+    remoteThread.start();
+    connect(ui->remoteCheckBox, &QCheckBox::toggled, this, &MainWindow::onRemoteToggled);
+    connect(ui->remoteTcpCheckBox, &QCheckBox::toggled, this, &MainWindow::onRemoteToggled);
+
+    // mask testing
+    connect(ui->maskLearnButton, &QPushButton::clicked, this, &MainWindow::onMaskLearn);
+    connect(ui->maskLoadButton, &QPushButton::clicked, this, &MainWindow::onMaskLoad);
+    connect(ui->maskRunCheckBox, &QCheckBox::toggled, this, &MainWindow::onMaskRunToggled);
+    connect(ui->maskToleranceSpinBox, &QSpinBox::valueChanged, this, &MainWindow::onMaskToleranceChanged);
+    connect(ui->maskHorizontalSpinBox, &QSpinBox::valueChanged, this, &MainWindow::onMaskToleranceChanged);
+
+    // memory browser, reads share the port so only while it is not streaming
+    peekPipeline = new PeekPipeline(&serial, this);
+    memoryModel = new MemoryModel(peekPipeline, this);
+    memoryModel->setReadAllowed([this]() { return serial.isOpen() && !isSampling; });
+    ui->memTableView->setModel(memoryModel);
+    ui->memTableView->verticalHeader()->hide();
+    ui->memTableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    ui->memAddressEdit->setValidator(new QRegularExpressionValidator(peekHexRegExp, this));
+    connect(ui->memGoButton, &QPushButton::clicked, this, &MainWindow::onMemoryGo);
+    connect(ui->memAddressEdit, &QLineEdit::returnPressed, this, &MainWindow::onMemoryGo);
+    connect(ui->memRefreshButton, &QPushButton::clicked, this, &MainWindow::onMemoryRefresh);
+    connect(ui->memDumpButton, &QPushButton::clicked, this, &MainWindow::onMemoryDump);
+    connect(memoryModel, &MemoryModel::pageLoaded, this, &MainWindow::onMemoryPageLoaded);
+    connect(peekPipeline, &PeekPipeline::failed, this, [this](const QString &message) {
+        memoryDumpPath.clear();
+        logInfo("Error: " + message);
+        failRemotePeeks(-240, "No response from the board");
+    });
+    connect(peekPipeline, &PeekPipeline::cancelled, this, [this]() { failRemotePeeks(-221, "Peek cancelled"); });
+    connect(peekPipeline, &PeekPipeline::wordsRead, this, &MainWindow::onRemotePeekRead);
+    connect(peekPipeline, &PeekPipeline::wordsRead, this, [this](int ticket, quint32, const QVector<quint32> &values) {
+        if (ticket == peekTicket && !values.isEmpty()) {
+            peekTicket = -1;
+            logInfo("Response: " + QString::number(values.first()) + " (0x" + QString::number(values.first(), 16).toUpper() + ")");
+        }
+    });
+
+    // register watch list, polls pause a serial stream for the replies
+    registerWatch = new RegisterWatch(peekPipeline, this);
+    // and not again before the display has had a whole frame since the last
+    registerWatch->setReadAllowed([this]() { return serial.isOpen() && !waitingForFrame; });
+    registerWatch->setInterval(ui->watchIntervalSpinBox->value());
+    ui->watchTableWidget->setColumnCount(4);
+    ui->watchTableWidget->setHorizontalHeaderLabels({"Address", "Value", "Changes", "Changed"});
+    ui->watchTableWidget->verticalHeader()->hide();
+    ui->watchAddressEdit->setValidator(new QRegularExpressionValidator(peekHexRegExp, this));
+    connect(ui->watchAddButton, &QPushButton::clicked, this, &MainWindow::onWatchAdd);
+    connect(ui->watchAddressEdit, &QLineEdit::returnPressed, this, &MainWindow::onWatchAdd);
+    connect(ui->watchRemoveButton, &QPushButton::clicked, this, &MainWindow::onWatchRemove);
+    connect(ui->watchRunCheckBox, &QCheckBox::toggled, this, &MainWindow::onWatchRunToggled);
+    connect(ui->watchIntervalSpinBox, &QSpinBox::valueChanged, registerWatch, &RegisterWatch::setInterval);
+    connect(ui->watchTableWidget, &QTableWidget::currentCellChanged, this, &MainWindow::drawWatchPlot);
+    connect(registerWatch, &RegisterWatch::polled, this, &MainWindow::onWatchPolled);
+
+    // amplitude histogram
+    connect(ui->histWindowComboBox, &QComboBox::currentIndexChanged, this, &MainWindow::onHistogramWindowChanged);
+    connect(ui->histResetButton, &QPushButton::clicked, this, [this]() { histogram.reset(); });
+
+    // eye diagram
+    eyeDiagram.configure(ui->eyeUiSpinBox->value());
+    connect(ui->eyeRunCheckBox, &QCheckBox::toggled, this, &MainWindow::onEyeRunToggled);
+    connect(ui->eyeUiSpinBox, &QDoubleSpinBox::valueChanged, this, &MainWindow::onEyeConfigChanged);
+    connect(ui->eyeResetButton, &QPushButton::clicked, this, &MainWindow::onEyeConfigChanged);
+
+    // waterfall, colormap and range only change the colour table
+    onSpectrogramConfigChanged();
+    connect(ui->specRunCheckBox, &QCheckBox::toggled, this, &MainWindow::onSpectrogramRunToggled);
+    connect(ui->specSizeComboBox, &QComboBox::currentIndexChanged, this, &MainWindow::onSpectrogramConfigChanged);
+    connect(ui->specOverlapComboBox, &QComboBox::currentIndexChanged, this, &MainWindow::onSpectrogramConfigChanged);
+    connect(ui->specColormapComboBox, &QComboBox::currentIndexChanged, this, &MainWindow::onSpectrogramDisplayChanged);
+    connect(ui->specFloorSpinBox, &QSpinBox::valueChanged, this, &MainWindow::onSpectrogramDisplayChanged);
+    connect(ui->specTopSpinBox, &QSpinBox::valueChanged, this, &MainWindow::onSpectrogramDisplayChanged);
+
+    // display filter and decimator
+    connect(ui->filterTypeComboBox, &QComboBox::currentIndexChanged, this, &MainWindow::onFilterChanged);
+    connect(ui->filterWindowComboBox, &QComboBox::currentIndexChanged, this, &MainWindow::onFilterChanged);
+    connect(ui->filterLowSpinBox, &QDoubleSpinBox::valueChanged, this, &MainWindow::onFilterChanged);
+    connect(ui->filterHighSpinBox, &QDoubleSpinBox::valueChanged, this, &MainWindow::onFilterChanged);
+    connect(ui->filterTapsSpinBox, &QSpinBox::valueChanged, this, &MainWindow::onFilterChanged);
+    connect(ui->decimateSpinBox, &QSpinBox::valueChanged, this, &MainWindow::onFilterChanged);
+    onFilterChanged();
+
+    // averaging and high resolution acquisition
+    connect(ui->acqModeComboBox, &QComboBox::currentIndexChanged, this, &MainWindow::onAcquisitionModeChanged);
+    connect(ui->acqCountSpinBox, &QSpinBox::valueChanged, this, &MainWindow::onAcquisitionModeChanged);
+    connect(ui->sampleSizeSpinner, &QSpinBox::valueChanged, this, &MainWindow::onAcquisitionModeChanged);
+    connect(ui->lockingLevelSlider, &QSlider::valueChanged, this, &MainWindow::onAcquisitionModeChanged);
+    onAcquisitionModeChanged();
+    connect(ui->rollCheckBox, &QCheckBox::toggled, this, &MainWindow::onRollModeChanged);
+    onRollModeChanged();
+
+    // reference waveforms
+    ui->refTableWidget->setColumnCount(3);
+    ui->refTableWidget->setHorizontalHeaderLabels({"Name", "Samples", "Rate"});
+    ui->refTableWidget->verticalHeader()->hide();
+    ui->refTableWidget->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    connect(ui->refStoreButton, &QPushButton::clicked, this, &MainWindow::onReferenceStore);
+    connect(ui->refNameEdit, &QLineEdit::returnPressed, this, &MainWindow::onReferenceStore);
+    connect(ui->refRemoveButton, &QPushButton::clicked, this, &MainWindow::onReferenceRemove);
+    connect(ui->refSaveButton, &QPushButton::clicked, this, &MainWindow::onReferenceSave);
+    connect(ui->refLoadButton, &QPushButton::clicked, this, &MainWindow::onReferenceLoad);
+    connect(ui->refTableWidget, &QTableWidget::itemChanged, this, &MainWindow::onReferenceItemChanged);
+
+    // recording and export, the exporter writes files on its own thread
+    connect(ui->recordCheckBox, &QCheckBox::toggled, this, &MainWindow::onRecordToggled);
+    connect(ui->exportButton, &QPushButton::clicked, this, &MainWindow::onExport);
+    connect(ui->exportCancelButton, &QPushButton::clicked, this, [this]() { exporter->cancel(); });
+
+    exporter = new WaveformExporter;
+    exporter->moveToThread(&exportThread);
+    connect(&exportThread, &QThread::finished, exporter, &QObject::deleteLater);
+    connect(exporter, &WaveformExporter::progress, this, &MainWindow::onExportProgress);
+    connect(exporter, &WaveformExporter::finished, this, &MainWindow::onExportFinished);
+    exportThread.start();
+
+    // stream counters, latency histograms and throughput, refreshed twice a second
+    statsTimer = new QTimer(this);
+    connect(statsTimer, &QTimer::timeout, this, &MainWindow::updateStats);
+    statsTimer->start(500);
+#ifdef RICHARDUINO_PERF
+    connect(ui->dumpStatsButton, &QPushButton::clicked, this, &MainWindow::onDumpStats);
+    connect(ui->resetStatsButton, &QPushButton::clicked, this, &MainWindow::onResetStats);
+#else
+    ui->statsOverlayCheckBox->setEnabled(false);
+    ui->dumpStatsButton->setEnabled(false);
+    ui->resetStatsButton->setEnabled(false);
+    ui->statsLabel->setText("Instrumentation is compiled out (RICHARDUINO_PERF)");
+#endif
 
     // update wave form timer
     updateTimer = new QTimer(this);
@@ -168,50 +337,92 @@ void MainWindow::smoothing() {
 }
 
 
-void MainWindow::smoothWaveformData(double windowSize) {
+void MainWindow::smoothWaveformData(double windowSize, bool channel1) {
+    PERF_SCOPE(PerfStage::Smooth);
 
-    if (waveformData.channel1.isEmpty()) {
-        return; // No data to smooth
+    // the display edge: raw codes in, doubles out, channel 1 averaged over
+    // the window on the way with an integer running sum
+    const double gain = 1.0 / (1 << kSampleFractionBits);
+    const QVector<qint16> &raw1 = currentBuffer.channel1;
+    if (!channel1) {
+        displayBuffer.channel1.clear();
+    } else if (acquisitionMode == AcquisitionMode::Average && frameAverager.count() > 0) {
+        // the averaged frame replaces the stream, it is smooth already
+        displayBuffer.channel1.resize(frameAverager.frameLength());
+        frameAverager.average(displayBuffer.channel1.data());
+    } else {
+        displayBuffer.channel1.resize(raw1.size());
+        dsp::boxAverage(raw1.constData(), raw1.size(), static_cast<int>(windowSize), displayBuffer.channel1.data(), gain);
     }
 
-    QVector<double> smoothedData;
-    int halfWindow = windowSize / 2;
+    const QVector<qint16> &raw2 = currentBuffer.channel2;
+    displayBuffer.channel2.resize(raw2.size());
+    dsp::scale(raw2.constData(), raw2.size(), gain, 0.0, displayBuffer.channel2.data());
+}
+
+void MainWindow::onAutoset() {
+    applyAutoset(true);
+}
 
-    for (int i = 0; i < waveformData.channel1.size(); ++i) {
-        double sum = 0;
-        int count = 0;
+bool MainWindow::applyAutoset(bool verbose) {
+    const int count = static_cast<int>(std::min<qsizetype>(recentSamples.size(), kAutosetWindow));
+    const qint8 *window = reinterpret_cast<const qint8 *>(recentSamples.constData()) + recentSamples.size() - count;
 
-        // Calculate the average of the samples within the window
-        for (int j = i - halfWindow; j <= i + halfWindow; ++j) {
-            if (j >= 0 && j < waveformData.channel1.size()) {
-                sum += waveformData.channel1[j];
-                count++;
-            }
+    SignalEstimate estimate = estimateSignal(window, count);
+    if (!estimate.valid) {
+        if (verbose) {
+            logInfo("Error: Autoset needs a live signal");
         }
+        return false;
+    }
+
+    // vertical: largest excursion fills 80% of half the plot, DC level centred
+    zoomLevel = std::max(1.0, estimate.amplitude / 0.8);
+    const double yScale = (ui->sineWaveLabel->height() / 2.0) / zoomLevel;
+    shiftValue = -qRound(estimate.offset * yScale);
+    ui->shiftGraphSpinner->setValue(shiftValue);
+
+    // the period is in raw samples, the frame and the smoothing in displayed ones
+    const double rate = currentSampleRate();
+    const double displayPeriod = rate > 0 ? estimate.period * displaySampleRate() / rate : estimate.period;
+
+    // timebase and trigger: three periods on screen, locked at the DC level
+    if (estimate.period > 0) {
+        ui->sampleSizeSpinner->setValue(qBound(64, qRound(displayPeriod * 3), ui->sampleSizeSpinner->maximum()));
+        ui->lockingLevelSlider->setValue(qBound(ui->lockingLevelSlider->minimum(), qRound(estimate.offset), ui->lockingLevelSlider->maximum()));
+        ui->lockingCheckBox->setChecked(true);
+    }
 
-        double average = sum / count;
-        smoothedData.append(average);
+    // smoothing only when the noise is visible, and never wider than a twentieth of a period
+    double windowSize = 0;
+    if (estimate.noise > estimate.amplitude * 0.02) {
+        windowSize = estimate.period > 0 ? displayPeriod / 20.0 : estimate.noise;
+        windowSize = std::round(qBound(1.0, windowSize, 15.0));
+    }
+    if (!ui->autoSmoothCheckBox->isChecked()) {
+        ui->SamplingIntervalSpinBox->setValue(windowSize);
     }
 
-    // Replace the original waveform data with the smoothed data
-    waveformData.channel1 = smoothedData;
+    if (verbose) {
+        QString period = estimate.period > 0
+            ? QString::number(estimate.period, 'f', 1) + " samples (" + QString::number(rate / estimate.period, 'f', 1) + " Hz)"
+            : QString("none");
+        logInfo("Autoset: offset " + QString::number(estimate.offset, 'f', 1)
+                + ", amplitude " + QString::number(estimate.amplitude, 'f', 1)
+                + ", noise " + QString::number(estimate.noise, 'f', 1)
+                + ", period " + period);
+    }
+    return true;
 }
 
 double MainWindow::calculateWaveformSmoothness() {
-    if (waveformData.channel1.size() < 2) {
+    if (currentBuffer.channel1.size() < 2) {
         return 0; // Not enough samples
     }
 
-    double sumDifferences = 0;
-    int count = 0;
-
-    for (int i = 1; i < waveformData.channel1.size(); ++i) {
-        double diff = std::abs(waveformData.channel1[i] - waveformData.channel1[i - 1]);
-        sumDifferences += diff;
-        count++;
-    }
-
-    double avgDifference = sumDifferences / count;
+    // measured on the raw codes, before any smoothing
+    double avgDifference = dsp::meanAbsDifference(currentBuffer.channel1.constData(), currentBuffer.channel1.size())
+        / (1 << kSampleFractionBits);
 
     // Calculate the smoothness factor based on the average difference
     double smoothnessFactor = 1.0 / (1.0 + avgDifference);
@@ -269,63 +480,207 @@ void MainWindow::onDataSliderInit() {
 }
 
 void MainWindow::onStartStopSampling() {
-    if (isConnected().isEmpty()) {
-        logInfo("Error: There is no comm port connection");
-        return;
-    }
-
     if (!isSampling) {
+        SampleSource *source = createSampleSource();
+        if (!source) {
+            return;
+        }
+
+        // the port is the sample stream from here on
+        peekPipeline->cancel();
+        memoryDumpPath.clear();
+
+        if (!source->start()) {
+            logInfo("Error: " + source->errorString());
+            delete source;
+            return;
+        }
+
+        sampleSource = source;
         isSampling = true;
-        logInfo("..... MEASURING .....");
+        registerWatch->setStream(qobject_cast<SerialSampleSource *>(source));
+        if (auto *serialSource = qobject_cast<SerialSampleSource *>(source)) {
+            connect(serialSource, &SerialSampleSource::paused, this, &MainWindow::onStreamGap);
+        }
+        waitingForFrame = false;
+        logInfo("..... MEASURING " + sampleSource->name() + " .....");
         ui->startSampling->setText("Stop Sampling");
+        ui->sourceComboBox->setEnabled(false);
+        ui->framedCheckBox->setEnabled(false);
+        framedStream = ui->framedCheckBox->isChecked();
+        frameParser.reset();
+        lastStreamStats = FrameParser::Stats();
         sampledData.channel1.clear();
         sampledData.channel2.clear();
+        currentBuffer.channel2.clear();
+        recentSamples.clear();
+        histogram.reset();
+        averageSlicer.reset();
+        frameAverager.reset();
+        rollView.reset();
         shiftValue = ui->shiftGraphSpinner->value();
 
-        connect(&serial, &QSerialPort::readyRead, this, &MainWindow::Sampling);
+        // a source still reading its format (WAV replay) comes back with ready()
+        if (sampleSource->sampleRate() > 0) {
+            onSourceReady();
+        }
+        connect(sampleSource, &SampleSource::ready, this, &MainWindow::onSourceReady);
+        connect(sampleSource, &SampleSource::failed, this, [this](const QString &message) {
+            logInfo("Error: " + message);
+            if (isSampling) {
+                stopSampling();
+            }
+        });
+        connect(sampleSource, &SampleSource::readyRead, this, &MainWindow::Sampling);
         //        updateTimerInterval();
-
-        // GO BIT
-        QString addressStr = "FFFFFFB0";
-        QString dataStr = "1";
-        bool isHex = true;
-        bool debug = false;
-        onPoke(addressStr, dataStr, isHex, debug);
     } else {
-        isSampling = false;
-        ui->startSampling->setText("Start Sampling");
-        logInfo("..... STOPPING .....");
+        stopSampling();
+    }
+}
+
+SampleSource *MainWindow::createSampleSource() {
+    const int index = ui->sourceComboBox->currentIndex();
+
+    if (index == 0) {
+        if (isConnected().isEmpty()) {
+            logInfo("Error: There is no comm port connection");
+            return nullptr;
+        }
+        return new SerialSampleSource(&serial, this);
+    }
+
+    if (index == 1 || index == 2) {
+        QString fileName = index == 1
+            ? QFileDialog::getOpenFileName(this, tr("Replay Capture"), "", tr("Capture Files (*.rcap);;All Files (*)"))
+            : QFileDialog::getOpenFileName(this, tr("Replay WAV"), "", tr("WAV Files (*.wav);;All Files (*)"));
+        if (fileName.isEmpty()) {
+            return nullptr;
+        }
+        if (index == 1) {
+            return new CaptureSampleSource(fileName, this);
+        }
+        return new WavSampleSource(fileName, this);
+    }
+
+    const auto shape = static_cast<SyntheticSampleSource::Shape>(index - 3);
+    return new SyntheticSampleSource(shape, ui->sourceRateSpinBox->value(), ui->sourceFrequencySpinBox->value(), this);
+}
+
+void MainWindow::stopSampling() {
+    isSampling = false;
+    ui->startSampling->setText("Start Sampling");
+    ui->sourceComboBox->setEnabled(true);
+    ui->framedCheckBox->setEnabled(true);
+    logInfo("..... STOPPING .....");
 
 //        if (timerId != -1) {
 //            killTimer(timerId);
 //        }
 
-        // GO BIT
-        QString addressStr = "FFFFFFB0";
-        QString dataStr = "0";
-        bool isHex = true;
-        bool debug = false;
-        onPoke(addressStr, dataStr, isHex, debug);
+    if (sampleSource) {
+        // a watch poll in progress lets go of the stream before it stops;
+        // first the stream, so abandoning the poll has nothing to resume
+        registerWatch->setStream(nullptr);
+        peekPipeline->cancel();
+        waitingForFrame = false;
+        disconnect(sampleSource, &SampleSource::readyRead, this, &MainWindow::Sampling);
+        sampleSource->stop();
+        sampleSource->deleteLater();
+        sampleSource = nullptr;
+    }
+}
+
+// everything designed for the source's rate
+void MainWindow::onSourceReady() {
+    onFilterChanged();
+    sharedStream.setSampleRate(currentSampleRate());
+}
 
-        // Read and discard all available data in the serial buffer
-        while (serial.bytesAvailable() > 0) {
-            serial.readAll();
-        }
-        disconnect(&serial, &QSerialPort::readyRead, this, &MainWindow::Sampling);
+// The samples after a resume do not follow on from those before the pause:
+// no triggered frame, filter history or display frame may span the gap, so
+// each starts over from the first sample after it.
+void MainWindow::onStreamGap() {
+    averageSlicer.reset();
+    maskSlicer.reset();
+    resetDisplayChains();
+    sampledData.channel1.clear();
+    sampledData.channel2.clear();
+    // frames sent while paused are not lost, just not asked for
+    frameParser.restartSequence();
+    waitingForFrame = true;
+}
+
+quint32 MainWindow::currentSampleRate() const {
+    return sampleSource ? sampleSource->sampleRate() : kSerialSampleRate;
+}
+
+void MainWindow::onShareToggled(bool checked) {
+    if (!checked) {
+        sharedStream.close();
+        logInfo("Shared stream closed");
+        return;
     }
+
+    if (!sharedStream.open(currentSampleRate())) {
+        logInfo("ERROR: " + sharedStream.errorString());
+        ui->shareCheckBox->setChecked(false);
+        return;
+    }
+    logInfo(QString("Sharing the live stream as %1").arg(richarduino::kStreamName));
 }
 // --------------------------------------------- Graphing
 
 void MainWindow::Sampling() {
+    PERF_SCOPE(PerfStage::SerialRead);
+
     // 8 bits datain
-    QByteArray data = serial.readAll();
+    QByteArray data = sampleSource->readAll();
+    PERF_ADD_BYTES(data.size());
+
+    if (framedStream) {
+        // payloads are read in place out of the received chunk
+        frameParser.parse(data, [this](quint8 channel, const char *payload, int length) {
+            sharedStream.write(channel, payload, length);
+            if (channel != 0) {
+                appendChainSamples(displayChains[1], reinterpret_cast<const qint8 *>(payload), length, sampledData.channel2);
+            } else {
+                appendDisplaySamples(payload, length);
+                recentSamples.append(payload, length);
+                if (captureWriter.isOpen()) {
+                    captureWriter.write(payload, length);
+                }
+                feedMaskTest(payload, length);
+                histogram.add(reinterpret_cast<const qint8 *>(payload), length);
+                if (eyeRunning) {
+                    eyeDiagram.feed(reinterpret_cast<const qint8 *>(payload), length);
+                }
+                if (spectrogramRunning) {
+                    spectrogram.feed(reinterpret_cast<const qint8 *>(payload), length);
+                }
+            }
+        });
+    } else {
+        // Append the new data to the sampledData buffer
+        appendDisplaySamples(data.constData(), data.size());
+
+        sharedStream.write(0, data.constData(), data.size());
+        recentSamples.append(data);
+        if (captureWriter.isOpen()) {
+            captureWriter.write(data);
+        }
+        feedMaskTest(data.constData(), data.size());
+        histogram.add(reinterpret_cast<const qint8 *>(data.constData()), data.size());
+        if (eyeRunning) {
+            eyeDiagram.feed(reinterpret_cast<const qint8 *>(data.constData()), data.size());
+        }
+        if (spectrogramRunning) {
+            spectrogram.feed(reinterpret_cast<const qint8 *>(data.constData()), data.size());
+        }
+    }
 
-    // Append the new data to the sampledData buffer
-    for (const auto &byte : data) {
-        quint8 unsignedValue = static_cast<quint8>(byte);
-        int8_t signedValue = static_cast<int8_t>(unsignedValue);
-        //double value = static_cast<double>(signedValue);
-        sampledData.channel1.append(signedValue);
+    // trimmed in bulk so the append stays amortised
+    if (recentSamples.size() > 2 * kAutosetWindow) {
+        recentSamples.remove(0, recentSamples.size() - kAutosetWindow);
     }
 }
 
@@ -333,142 +688,237 @@ void MainWindow::Sampling() {
 
 
 void MainWindow::updateWaveforms() {
+    PERF_SCOPE(PerfStage::Frame);
+    PERF_ADD_FRAME();
+
     const int bufferSize = ui->sampleSizeSpinner->value();
 
     // Update the currentBuffer with the most recent samples
     if (sampledData.channel1.size() >= bufferSize) {
         currentBuffer.channel1 = sampledData.channel1.mid(sampledData.channel1.size() - bufferSize);
         sampledData.channel1.remove(0, sampledData.channel1.size() - bufferSize);
+        waitingForFrame = false;
+    }
+    if (sampledData.channel2.size() >= bufferSize) {
+        currentBuffer.channel2 = sampledData.channel2.mid(sampledData.channel2.size() - bufferSize);
+        sampledData.channel2.remove(0, sampledData.channel2.size() - bufferSize);
     }
 
     // waveform <= currentBuffer
 
-    if (isSampling && ui->autoSmoothCheckBox->isChecked()) {
+    if (isSampling && ui->autoTrackCheckBox->isChecked()
+        && (!autoTrackClock.isValid() || autoTrackClock.elapsed() >= kAutoTrackIntervalMs)) {
+        autoTrackClock.start();
+        applyAutoset(false);
+    }
+
+    // roll mode draws channel 1 from its own min/max columns, the buffer
+    // wide smoothing and trigger passes over it would go unseen
+    const bool rolling = rollMode && !snapShot;
+    if (isSampling && ui->autoSmoothCheckBox->isChecked() && !rolling) {
         smoothing();
     }
-    smoothWaveformData(ui->SamplingIntervalSpinBox->value());
+    smoothWaveformData(ui->SamplingIntervalSpinBox->value(), !rolling);
     generateWaveformData(); // creates the waves
-    analyzeWaveformData(); // Call after generating data to analyze for trigger levels and log information
 
-    drawWaveform(ui->sineWaveLabel, waveformData.channel1);
-    drawWaveform(ui->squareWaveLabel, waveformData.channel2);
+    // the widgets are read here once, nothing below looks at them again
+    const FrameSettings settings = frameSettings();
+    analyzeWaveformData(settings); // Call after generating data to analyze for trigger levels and log information
+
+    if (rolling) {
+        drawRoll(settings);
+    } else {
+        drawWaveform(ui->sineWaveLabel, waveformData.channel1, settings);
+    }
+    drawWaveform(ui->squareWaveLabel, waveformData.channel2, settings);
+
+    QLabel *mathLabels[2] = {ui->math1WaveLabel, ui->math2WaveLabel};
+    for (int m = 0; m < 2; ++m) {
+        if (mathChannels[m].isValid()) {
+            mathChannels[m].evaluate(waveformData.channel1, waveformData.channel2, mathData[m]);
+            drawWaveform(mathLabels[m], mathData[m], settings);
+        }
+    }
+
+    if (maskTest.isReady() && ui->tabWidget->currentWidget() == ui->tab_mask) {
+        drawMask();
+    }
+    if (ui->tabWidget->currentWidget() == ui->tab_histogram) {
+        drawHistogram();
+    }
+    if (eyeRunning && ui->tabWidget->currentWidget() == ui->tab_eye) {
+        drawEye();
+    }
+    if (spectrogramRunning && ui->tabWidget->currentWidget() == ui->tab_spectrogram) {
+        drawSpectrogram();
+    }
+    const int reference = ui->refTableWidget->currentRow();
+    if (ui->tabWidget->currentWidget() == ui->tab_refs && reference >= 0 && reference < referenceLibrary.count()
+        && referenceDifference.count > 0) {
+        ui->refStatsLabel->setText(QString("live - %1 over %2 samples: mean %3, rms %4, peak %5")
+                                       .arg(referenceLibrary.at(reference).name)
+                                       .arg(referenceDifference.count)
+                                       .arg(referenceDifference.mean, 0, 'f', 2)
+                                       .arg(referenceDifference.rms, 0, 'f', 2)
+                                       .arg(referenceDifference.peak, 0, 'f', 1));
+    }
+}
+
+void MainWindow::onMathChanged() {
+    QLineEdit *edits[2] = {ui->math1Edit, ui->math2Edit};
+    QLabel *labels[2] = {ui->math1WaveLabel, ui->math2WaveLabel};
+    for (int m = 0; m < 2; ++m) {
+        const QString expression = edits[m]->text().trimmed();
+        if (expression == mathChannels[m].expression()) {
+            continue;
+        }
+
+        QString error;
+        if (expression.isEmpty()) {
+            mathChannels[m].clear();
+            logInfo("M" + QString::number(m + 1) + " cleared");
+        } else if (mathChannels[m].compile(expression, &error)) {
+            logInfo("M" + QString::number(m + 1) + " = " + expression);
+        } else {
+            logInfo("ERROR: M" + QString::number(m + 1) + ": " + error);
+        }
+
+        // an invalid channel is no longer drawn, nor is its last trace kept
+        if (!mathChannels[m].isValid()) {
+            mathData[m].clear();
+            labels[m]->clear();
+        }
+    }
 }
 
 
-void MainWindow::drawWaveform(QLabel* label, const QVector<double>& data) {
-    if (data.isEmpty()) return;
+FrameSettings MainWindow::frameSettings() const {
+    FrameSettings settings;
+    settings.locking = ui->lockingCheckBox->isChecked();
+    settings.lockingLevel = ui->lockingLevelSlider->value();
+    settings.triggerType = oscSettings.triggerType;
+    settings.triggerLevel = oscSettings.triggerLevel;
+    settings.zoom = zoomLevel;
+    settings.shift = shiftValue;
+    settings.sinc = ui->sincCheckBox->isChecked();
+    settings.statsOverlay = ui->statsOverlayCheckBox->isChecked();
+    return settings;
+}
+
+// one circle per set flag in [from, to), at the sample's place in the trace
+static void drawEdgeMarkers(QPainter &painter, const QPen &pen, const std::vector<quint8> &flags, int from, int to,
+                            int startIndex, double xScale, const QVector<double> &rows) {
+    painter.setPen(pen);
+    for (int i = from; i < to; ++i) {
+        if (flags[i]) {
+            painter.drawEllipse(QPointF((i - startIndex) * xScale, rows[i]), 2, 2);
+        }
+    }
+}
 
-    const QVector<double>& displayData = data;
+void MainWindow::drawWaveform(QLabel* label, const QVector<double>& data, const FrameSettings &settings) {
+    if (data.isEmpty()) return;
+    PERF_SCOPE(PerfStage::Draw);
 
     // Setup for drawing
     QSize labelSize = label->size();
+
+    // sparse traces are upsampled to one point per pixel before anything
+    // else looks at them, so cost follows the plot width
+    const bool interpolate = settings.sinc && data.size() > 1 && data.size() < labelSize.width();
+    if (interpolate) {
+        const int width = labelSize.width();
+        interpolatedData.resize(width);
+        sincInterpolator.resample(data.constData(), data.size(), 0.0, (data.size() - 1) / static_cast<double>(width - 1),
+                                  width, interpolatedData.data());
+    }
+    const QVector<double>& displayData = interpolate ? interpolatedData : data;
+    const int count = displayData.size();
+
     QPixmap pixmap(labelSize);
     pixmap.fill(Qt::white);
     QPainter painter(&pixmap);
     QPen pen(Qt::black);
     painter.setPen(pen);
 
-    double xScale = labelSize.width() / static_cast<double>(displayData.size() - 1);
-    double yScale = (labelSize.height() / 2.0) / zoomLevel;
-
-    QPainterPath path;
-    int triggerIndex = -1; // Initialize triggerIndex to -1 (no trigger)
+    double xScale = labelSize.width() / static_cast<double>(count - 1);
+    double yScale = (labelSize.height() / 2.0) / settings.zoom;
+    double midY = labelSize.height() / 2.0;
 
-    // Check if rising edge trigger is enabled
-    if (ui->lockingCheckBox->isChecked()) {
-        // Find the index of the first rising edge above the trigger level
-        double triggerLevel = ui->lockingLevelSlider->value();
-        for (int i = 1; i < displayData.size(); ++i) {
-            if (displayData[i] < displayData[i - 1] && displayData[i] > triggerLevel) {
-                triggerIndex = i;
-                break;
-            }
-        }
-    }
+    // every sample's pixel row in one pass
+    traceRows.resize(count);
+    dsp::scale(displayData.constData(), count, -yScale, midY - settings.shift, traceRows.data());
 
-    double yPos;
-    int startIndex = 0;
-    if (triggerIndex == -1) {
-        yPos = labelSize.height() / 2.0 - displayData[0] * yScale - shiftValue;
-        path.moveTo(0, yPos);
-    } else {
-        startIndex = triggerIndex;
-        yPos = labelSize.height() / 2.0 - displayData[triggerIndex] * yScale - shiftValue;
-        path.moveTo((triggerIndex - 1) * xScale, yPos);
+    // locking: the first lock edge starts the trace, the later ones get markers
+    int triggerIndex = -1; // Initialize triggerIndex to -1 (no trigger)
+    if (settings.locking) {
+        lockFlags.resize(count);
+        dsp::markEdges<dsp::Edge::Lock>(displayData.constData(), count, settings.lockingLevel, lockFlags.data());
+        triggerIndex = static_cast<int>(dsp::firstFlag(lockFlags.data(), 1, count));
     }
+    const int startIndex = triggerIndex == -1 ? 0 : triggerIndex;
 
     // Draw a horizontal line at the middle of the screen
     painter.setPen(Qt::darkGreen);
-    double midY = labelSize.height() / 2.0;
     painter.drawLine(0, midY, labelSize.width(), midY);
-    painter.setPen(pen);
-
-    for (int i = startIndex; i < displayData.size() - 1; ++i) {
-        double nextYPos = labelSize.height() / 2.0 - displayData[i] * yScale - shiftValue;
-        double xPos = (i - startIndex) * xScale;
 
-        // Rising Edge detection and highlighting
-        bool risingEdgeDetected = false;
-        if (ui->lockingCheckBox->isChecked() && i > startIndex && displayData[i] < displayData[i - 1] && displayData[i] > ui->lockingLevelSlider->value() && !risingEdgeDetected) {
-            painter.setPen(QPen(Qt::magenta, 2));
-            painter.drawEllipse(QPointF(xPos, nextYPos), 2, 2);
-            painter.setPen(pen);
-            risingEdgeDetected = true;
-        }
-
-        // Rising Edge detection and highlighting
-        if (oscSettings.triggerType == RisingEdgeHighlighter && i < displayData.size() - 1 && displayData[i] < displayData[i + 1]) {
-            painter.setPen(QPen(Qt::red, 2));
-            painter.drawEllipse(QPointF(xPos, nextYPos), 2, 2);
-            painter.setPen(pen);
-        }
+    // stored references go under everything else, lined up on the real samples
+    if (label == ui->sineWaveLabel && referenceLibrary.count() > 0) {
+        const int liveStart = interpolate ? qRound(startIndex * (data.size() - 1) / static_cast<double>(count - 1)) : startIndex;
+        drawReferences(painter, labelSize, data, liveStart, settings);
+    }
 
-        // Falling Edge detection and highlighting
-        if (oscSettings.triggerType == FallingEdgeHighlighter && i < displayData.size() - 1 && displayData[i] > displayData[i + 1]) {
-            painter.setPen(QPen(Qt::blue, 2));
-            painter.drawEllipse(QPointF(xPos, nextYPos), 2, 2);
-            painter.setPen(pen);
+    // markers, the mode decided here once rather than per sample
+    if (settings.locking) {
+        drawEdgeMarkers(painter, QPen(Qt::magenta, 2), lockFlags, startIndex + 1, count - 1, startIndex, xScale, traceRows);
+    }
+    if (settings.triggerType == RisingEdgeHighlighter || settings.triggerType == FallingEdgeHighlighter) {
+        edgeFlags.resize(count);
+        if (settings.triggerType == RisingEdgeHighlighter) {
+            dsp::markEdges<dsp::Edge::Rising>(displayData.constData(), count, 0.0, edgeFlags.data());
+        } else {
+            dsp::markEdges<dsp::Edge::Falling>(displayData.constData(), count, 0.0, edgeFlags.data());
         }
+        const QPen markerPen(settings.triggerType == RisingEdgeHighlighter ? Qt::red : Qt::blue, 2);
+        drawEdgeMarkers(painter, markerPen, edgeFlags, startIndex, count - 1, startIndex, xScale, traceRows);
+    }
+    painter.setPen(pen);
 
-        path.lineTo(xPos, nextYPos);
+    QPainterPath path;
+    if (triggerIndex == -1) {
+        path.moveTo(0, traceRows[0]);
+    } else {
+        path.moveTo((triggerIndex - 1) * xScale, traceRows[triggerIndex]);
+    }
+    for (int i = startIndex; i < count - 1; ++i) {
+        path.lineTo((i - startIndex) * xScale, traceRows[i]);
     }
 
     // If there are not enough data points after the trigger index, start a new path from the beginning
-    if (triggerIndex != -1 && displayData.size() - triggerIndex < labelSize.width() / xScale) {
+    if (triggerIndex != -1 && count - triggerIndex < labelSize.width() / xScale) {
         QPainterPath remainingPath;
-        double remainingXPos = (displayData.size() - triggerIndex) * xScale;
-
-        for (int i = triggerIndex; i < displayData.size(); ++i) {
-            double nextYPos = labelSize.height() / 2.0 - displayData[i] * yScale - shiftValue;
-            double xPos = (i - triggerIndex) * xScale;
+        double remainingXPos = (count - triggerIndex) * xScale;
 
-            if (i == triggerIndex) {
-                remainingPath.moveTo(xPos, nextYPos);
-            } else {
-                remainingPath.lineTo(xPos, nextYPos);
-            }
+        remainingPath.moveTo(0, traceRows[triggerIndex]);
+        for (int i = triggerIndex + 1; i < count; ++i) {
+            remainingPath.lineTo((i - triggerIndex) * xScale, traceRows[i]);
         }
 
         // Draw the remaining path from the beginning only if necessary
         if (remainingXPos < labelSize.width()) {
-            for (int i = 0; i < triggerIndex; ++i) {
-                double nextYPos = labelSize.height() / 2.0 - displayData[i] * yScale - shiftValue;
-                double xPos = remainingXPos + i * xScale;
-
-                if (xPos < labelSize.width()) {
-                    remainingPath.lineTo(xPos, nextYPos);
-                } else {
-                    break;
-                }
+            const int fits = static_cast<int>(std::ceil((labelSize.width() - remainingXPos) / xScale));
+            for (int i = 0; i < std::min(triggerIndex, fits); ++i) {
+                remainingPath.lineTo(remainingXPos + i * xScale, traceRows[i]);
             }
         }
 
         painter.drawPath(remainingPath);
     }
 
-    // Calculate max and min values from data
-    double maxVal = *std::max_element(displayData.constBegin(), displayData.constEnd());
-    double minVal = *std::min_element(displayData.constBegin(), displayData.constEnd());
+    // Calculate max and min values from data, the real samples not the interpolated trace
+    double minVal;
+    double maxVal;
+    dsp::minMax(data.constData(), data.size(), minVal, maxVal);
 
     // Draw max and min values on the graph
     painter.setPen(Qt::black); // Use black pen for text
@@ -476,8 +926,8 @@ void MainWindow::drawWaveform(QLabel* label, const QVector<double>& data) {
     painter.drawText(QPointF(5, labelSize.height() - 5), QString("Min: %1").arg(minVal));
 
     // Draw trigger line if trigger mode is set
-    if (oscSettings.triggerType == TriggerLevel) {
-        double triggerYPos = labelSize.height() / 2.0 - oscSettings.triggerLevel * yScale; // Corrected trigger line position
+    if (settings.triggerType == TriggerLevel) {
+        double triggerYPos = midY - settings.triggerLevel * yScale; // Corrected trigger line position
         QPen triggerPen(Qt::green, 1);
         painter.setPen(triggerPen);
         painter.drawLine(0, triggerYPos, labelSize.width(), triggerYPos);
@@ -485,16 +935,23 @@ void MainWindow::drawWaveform(QLabel* label, const QVector<double>& data) {
     }
 
     // Draw locking line if locking is enabled
-    double lockingLevel = ui->lockingLevelSlider->value();
-    double lockingYPos = labelSize.height() / 2.0 - lockingLevel * yScale;
+    double lockingYPos = midY - settings.lockingLevel * yScale;
     QPen lockingPen(Qt::darkBlue, 1);
-    if (ui->lockingCheckBox->isChecked()) {
+    if (settings.locking) {
         lockingPen.setColor(Qt::red);
     }
     painter.setPen(lockingPen);
     painter.drawLine(0, lockingYPos, labelSize.width(), lockingYPos);
     painter.setPen(pen);
 
+#ifdef RICHARDUINO_PERF
+    if (label == ui->sineWaveLabel && settings.statsOverlay) {
+        painter.setPen(Qt::darkGray);
+        painter.drawText(QRectF(0, 5, labelSize.width() - 5, labelSize.height() - 10), Qt::AlignRight | Qt::AlignTop, perfOverlayText);
+        painter.setPen(pen);
+    }
+#endif
+
     painter.setRenderHint(QPainter::Antialiasing);
     painter.drawPath(path);
     label->setPixmap(pixmap);
@@ -504,16 +961,13 @@ void MainWindow::drawWaveform(QLabel* label, const QVector<double>& data) {
 void MainWindow::generateWaveformData() {
     if (!snapShot) {
         if (!isTrig1Hit) {
-            waveformData.channel1.clear();
-            if (!currentBuffer.channel1.isEmpty()) {
-                waveformData.channel1 = currentBuffer.channel1;
-            }
+            waveformData.channel1 = displayBuffer.channel1;
         } else {
             waveformData.channel1 = snapShotData.channel1;
         }
 
         if (!isTrig2Hit) {
-            waveformData.channel2.clear();
+            waveformData.channel2 = displayBuffer.channel2; // only fed by the framed stream
             //            for (int i = 0; i < 511; ++i) {
             //                waveformData.channel2.append(((i % 20) < 10 ? 1 : -1) * dataMultiplier); // Apply multiplier
             //            }
@@ -531,6 +985,11 @@ void MainWindow::generateWaveformData() {
 
 void MainWindow::onSnapshot() {
     if (!snapShot) {
+        if (rollMode && !isTrig1Hit) {
+            // roll mode leaves channel 1 without a frame, the snapshot makes one
+            smoothWaveformData(ui->SamplingIntervalSpinBox->value());
+            waveformData.channel1 = displayBuffer.channel1;
+        }
         snapShotData.channel1 = waveformData.channel1;
         snapShotData.channel2 = waveformData.channel2;
         logInfo("SNAPSHOT ENABLED");
@@ -598,119 +1057,1287 @@ void MainWindow::setTriggerLevel() {
 
 
 
-void MainWindow::analyzeWaveformData() {
-    bool triggerLevelReachedChannel1 = std::any_of(waveformData.channel1.begin(), waveformData.channel1.end(), [this](double value) {
-        return oscSettings.triggerType == TriggerLevel && std::abs(value) >= oscSettings.triggerLevel;
-    });
+void MainWindow::analyzeWaveformData(const FrameSettings &settings) {
+    PERF_SCOPE(PerfStage::Analyze);
 
-    bool triggerLevelReachedChannel2 = std::any_of(waveformData.channel2.begin(), waveformData.channel2.end(), [this](double value) {
-        return oscSettings.triggerType == TriggerLevel && std::abs(value) >= oscSettings.triggerLevel;
-    });
+    if (settings.triggerType != TriggerLevel) {
+        return;
+    }
+
+    bool triggerLevelReachedChannel1 = dsp::anyAbsAtLeast(waveformData.channel1.constData(), waveformData.channel1.size(), settings.triggerLevel);
+    bool triggerLevelReachedChannel2 = dsp::anyAbsAtLeast(waveformData.channel2.constData(), waveformData.channel2.size(), settings.triggerLevel);
 
     if (triggerLevelReachedChannel1 && !isTrig1Hit) {
-        logInfo("Trigger Level reached: Wave 1, trigger level: " + QString::number(oscSettings.triggerLevel));
+        logInfo("Trigger Level reached: Wave 1, trigger level: " + QString::number(settings.triggerLevel));
         isTrig1Hit = true;
         snapShotData.channel1 = waveformData.channel1;
     }
 
     if (triggerLevelReachedChannel2 && !isTrig2Hit) {
-        logInfo("Trigger Level reached: Wave 2, trigger level: " + QString::number(oscSettings.triggerLevel));
+        logInfo("Trigger Level reached: Wave 2, trigger level: " + QString::number(settings.triggerLevel));
         isTrig2Hit = true;
         snapShotData.channel2 = waveformData.channel2;
     }
 
 }
 
-// --------------------------------------------- PEEK, POKE AND VERSION
+// --------------------------------------------- REMOTE CONTROL
 
-void MainWindow::onPoke(const QString &addressStr, const QString &dataStr, bool isHex, bool debug) {
-    if (isConnected().isEmpty()) {
-        logInfo("Error: There is no comm port connection");
+void MainWindow::onRemoteToggled() {
+    RemoteServer *server = remoteServer;
+    if (!ui->remoteCheckBox->isChecked()) {
+        QMetaObject::invokeMethod(server, &RemoteServer::close, Qt::QueuedConnection);
         return;
     }
 
-    bool okAddress, okData;
-    uint32_t address = addressStr.toUInt(&okAddress, 16); // Address is always hex
-    if(!okAddress){
-        logInfo("invalid address format");
+    const quint16 port = ui->remoteTcpCheckBox->isChecked() ? ui->remotePortSpinBox->value() : 0;
+    QMetaObject::invokeMethod(server, [server, port]() { server->listen(port); }, Qt::QueuedConnection);
+}
+
+// the pipeline takes exactly one word per address, so values line up with the request
+void MainWindow::onRemotePeekRead(int ticket, quint32 address, const QVector<quint32> &values) {
+    Q_UNUSED(address);
+    const RemoteServer::Done done = remotePeeks.take(ticket);
+    if (!done) {
+        return; // the memory browser's or the watch list's
+    }
+    QByteArray reply;
+    for (int i = 0; i < values.size(); ++i) {
+        if (i > 0) {
+            reply.append(',');
+        }
+        reply.append(QByteArray::number(values[i]));
     }
+    done(RemoteResult::text(reply));
+}
 
-    uint32_t data;
+void MainWindow::failRemotePeeks(int code, const QString &message) {
+    QHash<int, RemoteServer::Done> peeks;
+    peeks.swap(remotePeeks); // a done may queue the next peek
+    for (const RemoteServer::Done &done : peeks) {
+        done(RemoteResult::failure(code, message));
+    }
+}
 
-    if (isHex) {
-        data = dataStr.toUInt(&okData, 16);
-    } else {
-        data = dataStr.toUInt(&okData);
-        // Check if data exceeds 32 bits after conversion to hex
-        if (okData && QString::number(data, 16).length() > 8) {
-            logInfo("Data exceeds 32 bits");
-            return;
-        }
+// Runs on the GUI thread, called by the remote server once per command.
+// Addresses and data are decimal, or hex with a 0x or #H prefix. Nothing
+// here waits on the board: peeks are queued on the pipeline and answered
+// through done when their words are in.
+RemoteResult MainWindow::handleRemoteCommand(const RemoteCommand &command, const RemoteServer::Done &done) {
+    const QByteArray &header = command.header;
+    const QList<QByteArray> &args = command.arguments;
+    auto is = [&header](const char *pattern) { return RemoteServer::matches(header, pattern); };
+
+    if (is("*OPC") && command.query) {
+        return RemoteResult::text("1"); // every earlier command of the batch has run
     }
 
-    if (!okData) {
-        logInfo("Invalid Data format");
-        return;
+    // 1 ----------------------------- connection ----------------------------
+    if (is("SYSTem:CONNect")) {
+        if (command.query) {
+            return RemoteResult::text(serial.isOpen() ? serial.portName().toUtf8() : QByteArray());
+        }
+        if (args.size() != 1) {
+            return RemoteResult::failure(-109, "Missing parameter");
+        }
+        const QString port = QString::fromUtf8(args[0]);
+        if (serial.isOpen()) {
+            if (serial.portName() == port) {
+                return RemoteResult();
+            }
+            initializeSerialCommunication(); // disconnects
+        }
+        if (ui->comPortComboBox->findText(port) < 0) {
+            ui->comPortComboBox->addItem(port);
+        }
+        ui->comPortComboBox->setCurrentText(port);
+        initializeSerialCommunication();
+        if (!serial.isOpen()) {
+            return RemoteResult::failure(-240, "Cannot open " + port);
+        }
+        return RemoteResult();
+    }
+    if (is("SYSTem:DISConnect")) {
+        if (serial.isOpen()) {
+            initializeSerialCommunication();
+        }
+        return RemoteResult();
     }
 
+    // 2 ----------------------------- peek and poke ----------------------------
+    if (is("MEMory:PEEK") || is("MEMory:PEEK:BATCh") || is("MEMory:POKE") || is("MEMory:POKE:BATCh")) {
+        if (!serial.isOpen()) {
+            return RemoteResult::failure(-240, "No comm port connection");
+        }
 
-    Poke poke(&serial);
-    poke.execute(address, data);
+        QVector<uint32_t> values;
+        for (const QByteArray &arg : args) {
+            quint32 value;
+            if (!RemoteServer::toUInt(arg, &value)) {
+                return RemoteResult::failure(-104, "Bad number " + QString::fromUtf8(arg));
+            }
+            values.append(value);
+        }
 
-    // Log message in both decimal and hex
-    QString decimalData = QString::number(data);
-    QString hexData = QString::number(data, 16).toUpper();
-    if (debug){
-        QString messageLog = QString("Sent: Address = 0x%1, Data = %2 (0x%3)").arg(addressStr, decimalData, hexData);
-        logInfo(messageLog);
-    }
-}
+        if (is("MEMory:PEEK") || is("MEMory:PEEK:BATCh")) {
+            if (!command.query || values.isEmpty()) {
+                return RemoteResult::failure(-109, "Missing address");
+            }
+            if (isSampling) {
+                return RemoteResult::failure(-221, "Cannot peek while sampling is active");
+            }
+            remotePeeks.insert(peekPipeline->read(values), done);
+            return RemoteResult::later();
+        }
 
-void MainWindow::onPeek(const QString &addressStr, bool debug) {
-    if (isConnected().isEmpty()) {
-        logInfo("Error: There is no comm port connection");
-        return;
+        // address,data pairs
+        if (values.isEmpty() || values.size() % 2 != 0) {
+            return RemoteResult::failure(-109, "Expected address,data pairs");
+        }
+        QVector<uint32_t> addresses;
+        QVector<uint32_t> data;
+        for (int i = 0; i < values.size(); i += 2) {
+            addresses.append(values[i]);
+            data.append(values[i + 1]);
+        }
+        Poke(&serial).executeBatch(addresses, data);
+        return RemoteResult();
     }
 
-    if (isSampling) {
-        logInfo("Error: Cannot peek while sampling is active");
-        return;
+    // 3 ----------------------------- sampling ----------------------------
+    if (is("SAMPle:STARt") || is("SAMPle:STOP")) {
+        const bool start = is("SAMPle:STARt");
+        if (start && !isSampling) {
+            // replay sources would open a file dialog
+            const int source = ui->sourceComboBox->currentIndex();
+            if (source == 1 || source == 2) {
+                return RemoteResult::failure(-221, "Select the serial port or a generator as the source");
+            }
+            onStartStopSampling();
+            if (!isSampling) {
+                return RemoteResult::failure(-200, "Sampling did not start");
+            }
+        } else if (!start && isSampling) {
+            stopSampling();
+        }
+        return RemoteResult();
     }
-
-    bool ok;
-    uint64_t longAddress = addressStr.toULongLong(&ok, 16);
-    uint32_t address = static_cast<uint32_t>(longAddress);
-    if (!ok) {
-        logInfo("Invalid address format");
-        return;
+    if (is("SAMPle:STATe") && command.query) {
+        return RemoteResult::text(isSampling ? "1" : "0");
     }
 
-    Peek peek(&serial);
-    QByteArray responseData = peek.execute(address);
+    // 4 ----------------------------- trigger ----------------------------
+    if (is("TRIGger:LEVel")) {
+        if (command.query) {
+            return RemoteResult::text(QByteArray::number(oscSettings.triggerLevel));
+        }
+        bool ok = args.size() == 1;
+        const double level = ok ? args[0].toDouble(&ok) : 0.0;
+        if (!ok) {
+            return RemoteResult::failure(-104, "Bad trigger level");
+        }
+        oscSettings.triggerLevel = level;
+        ui->triggerValue->setPlainText(QString::number(level));
+        return RemoteResult();
+    }
+    if (is("TRIGger:MODE")) {
+        static const char *names[] = {"NONE", "RIS", "FALL", "LEV"};
+        if (command.query) {
+            return RemoteResult::text(names[oscSettings.triggerType]);
+        }
+        if (args.size() != 1) {
+            return RemoteResult::failure(-109, "Missing trigger mode");
+        }
+        if (RemoteServer::matches(args[0], "NONE")) {
+            oscSettings.triggerType = NoTrigger;
+            isTrig1Hit = false;
+            isTrig2Hit = false;
+        } else if (RemoteServer::matches(args[0], "RISing")) {
+            oscSettings.triggerType = RisingEdgeHighlighter;
+        } else if (RemoteServer::matches(args[0], "FALLing")) {
+            oscSettings.triggerType = FallingEdgeHighlighter;
+        } else if (RemoteServer::matches(args[0], "LEVel")) {
+            oscSettings.triggerType = TriggerLevel;
+        } else {
+            return RemoteResult::failure(-224, "Illegal trigger mode");
+        }
+        return RemoteResult();
+    }
 
-    // Process and display response data
-    if (!responseData.isEmpty() && responseData.size() >= sizeof(uint32_t)) {
-        if(debug){
-            uint32_t responseValue;
-            memcpy(&responseValue, responseData.data(), sizeof(uint32_t));
-            logInfo("Response: " + QString::number(responseValue) + " (0x" + QString::number(responseValue, 16).toUpper() + ")");
+    // 5 ----------------------------- waveforms ----------------------------
+    if (is("WAVeform:DATA") && command.query) {
+        // the displayed frame as signed 8 bit samples
+        const bool second = !args.isEmpty() && RemoteServer::matches(args[0], "CH2");
+        const QVector<double> &channel = second ? waveformData.channel2 : waveformData.channel1;
+        QByteArray data(channel.size(), Qt::Uninitialized);
+        for (int i = 0; i < channel.size(); ++i) {
+            data[i] = static_cast<char>(qBound(-128, qRound(channel[i]), 127));
         }
-    } else {
-        logInfo("Invalid response received");
+        return RemoteResult::block(data);
+    }
+    if (is("WAVeform:RATE") && command.query) {
+        return RemoteResult::text(QByteArray::number(displaySampleRate(), 'g', 10));
     }
 
+    return RemoteResult::failure(-113, "Undefined header");
 }
 
-void MainWindow::onVersion() {
-    if (isConnected().isEmpty()) {
-        logInfo("Error: There is no comm port connection");
+// --------------------------------------------- MASK TEST
+
+void MainWindow::configureMaskSlicer(TriggerSlicer &slicer) const {
+    const int length = ui->maskLengthSpinBox->value();
+    const TriggerSlicer::Edge edge = ui->maskEdgeComboBox->currentIndex() == 0 ? TriggerSlicer::Edge::Rising
+                                                                               : TriggerSlicer::Edge::Falling;
+    // a quarter of the frame before the edge, like the default scope view
+    slicer.configure(ui->maskLevelSpinBox->value(), edge, length, length / 4);
+}
+
+void MainWindow::feedMaskTest(const char *samples, int count) {
+    if (!maskLearning && !maskRunning) {
         return;
     }
 
-    Version version(&serial);
-    QByteArray response = version.execute();
-
-    if (!response.isEmpty()) {
+    maskSlicer.feed(reinterpret_cast<const qint8 *>(samples), count, [this](const qint8 *frame) {
+        const int length = maskSlicer.frameLength();
+        if (maskLearning) {
+            maskTest.learn(frame);
+            if (maskTest.learnedFrames() >= kMaskLearnFrames) {
+                maskLearning = false;
+                maskTest.finishLearning(ui->maskToleranceSpinBox->value(), ui->maskHorizontalSpinBox->value());
+                logInfo("Mask learned from " + QString::number(maskTest.learnedFrames()) + " frames");
+            }
+            lastMaskFrame.assign(frame, frame + length);
+            lastMaskFrameFailed = false;
+            return;
+        }
+        if (!maskRunning) {
+            return; // learning finished earlier in this block
+        }
+
+        const bool failed = maskTest.test(frame) > 0;
+        if (failed) {
+            if (maskFailWriter.isOpen()) {
+                maskFailWriter.write(reinterpret_cast<const char *>(frame), length);
+            }
+            // keep showing the latest failure until the next one
+            lastMaskFrame.assign(frame, frame + length);
+            lastMaskFrameFailed = true;
+        } else if (!lastMaskFrameFailed) {
+            lastMaskFrame.assign(frame, frame + length);
+        }
+    });
+}
+
+void MainWindow::onMaskLearn() {
+    if (!isSampling) {
+        logInfo("Error: Start sampling before learning a mask");
+        return;
+    }
+
+    ui->maskRunCheckBox->setChecked(false);
+    configureMaskSlicer(maskSlicer);
+    maskTest.beginLearning(maskSlicer.frameLength());
+    lastMaskFrame.clear();
+    maskLearning = true;
+    logInfo("Learning mask from the next " + QString::number(kMaskLearnFrames) + " triggered frames");
+}
+
+void MainWindow::onMaskLoad() {
+    QString fileName = QFileDialog::getOpenFileName(this,
+                                                    tr("Load Mask Reference"), "",
+                                                    tr("Capture Files (*.rcap)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    CaptureReader reader;
+    if (!reader.open(fileName)) {
+        logInfo("ERROR: " + reader.errorString());
+        return;
+    }
+    if (reader.channelCount() != 1) {
+        logInfo("Error: Mask references must be single channel captures");
+        return;
+    }
+
+    // slice the capture with the current trigger settings, same as live data
+    ui->maskRunCheckBox->setChecked(false);
+    maskLearning = false;
+    TriggerSlicer slicer;
+    configureMaskSlicer(slicer);
+    maskTest.beginLearning(slicer.frameLength());
+
+    QByteArray block(65536, Qt::Uninitialized);
+    qint64 read;
+    while (maskTest.learnedFrames() < kMaskLearnFrames && (read = reader.read(block.data(), block.size())) > 0) {
+        slicer.feed(reinterpret_cast<const qint8 *>(block.constData()), static_cast<int>(read), [this](const qint8 *frame) {
+            if (maskTest.learnedFrames() < kMaskLearnFrames) {
+                maskTest.learn(frame);
+                lastMaskFrame.assign(frame, frame + maskTest.frameLength());
+            }
+        });
+    }
+
+    if (!maskTest.finishLearning(ui->maskToleranceSpinBox->value(), ui->maskHorizontalSpinBox->value())) {
+        logInfo("Error: No triggered frame found in " + QFileInfo(fileName).fileName());
+        return;
+    }
+    lastMaskFrameFailed = false;
+    logInfo("Mask learned from " + QString::number(maskTest.learnedFrames()) + " frames of " + QFileInfo(fileName).fileName());
+    drawMask();
+}
+
+void MainWindow::onMaskRunToggled(bool checked) {
+    if (!checked) {
+        if (maskRunning) {
+            maskRunning = false;
+            logInfo(QString("Mask test stopped, %1 passed, %2 failed")
+                        .arg(maskTest.passCount()).arg(maskTest.failCount()));
+        }
+        if (maskFailWriter.isOpen()) {
+            maskFailWriter.close();
+            logInfo("Failing frames saved to " + maskFailWriter.fileName());
+        }
+        return;
+    }
+
+    if (!maskTest.isReady()) {
+        logInfo("Error: Learn or load a mask reference first");
+        ui->maskRunCheckBox->setChecked(false);
+        return;
+    }
+
+    if (ui->maskSaveFailsCheckBox->isChecked()) {
+        QString fileName = QFileDialog::getSaveFileName(this,
+                                                        tr("Save Failing Frames"), "",
+                                                        tr("Capture Files (*.rcap)"));
+        if (fileName.isEmpty()) {
+            ui->maskRunCheckBox->setChecked(false);
+            return;
+        }
+        // failing frames are stored back to back, frame length apart
+        if (!maskFailWriter.open(fileName, currentSampleRate())) {
+            logInfo("ERROR: cannot open " + fileName + ". " + maskFailWriter.errorString());
+            ui->maskRunCheckBox->setChecked(false);
+            return;
+        }
+    }
+
+    // the slicer must cut frames the same length as the reference
+    configureMaskSlicer(maskSlicer);
+    if (maskSlicer.frameLength() != maskTest.frameLength()) {
+        ui->maskLengthSpinBox->setValue(maskTest.frameLength());
+        configureMaskSlicer(maskSlicer);
+    }
+    maskTest.resetCounters();
+    lastMaskFrameFailed = false;
+    maskRunning = true;
+    logInfo("Mask test running");
+}
+
+void MainWindow::onMaskToleranceChanged() {
+    // the learned min/max are kept, only the envelope is rebuilt
+    if (maskTest.isReady() && !maskLearning) {
+        maskTest.finishLearning(ui->maskToleranceSpinBox->value(), ui->maskHorizontalSpinBox->value());
+        drawMask();
+    }
+}
+
+void MainWindow::drawMask() {
+    QLabel *label = ui->maskWaveLabel;
+    const std::vector<qint8> &upper = maskTest.upperEnvelope();
+    const std::vector<qint8> &lower = maskTest.lowerEnvelope();
+    const int length = static_cast<int>(upper.size());
+    if (length < 2) {
+        return;
+    }
+
+    QSize labelSize = label->size();
+    QPixmap pixmap(labelSize);
+    pixmap.fill(Qt::white);
+    QPainter painter(&pixmap);
+
+    const double xScale = labelSize.width() / static_cast<double>(length - 1);
+    const double yScale = (labelSize.height() / 2.0) / zoomLevel;
+    auto yOf = [&](double value) { return labelSize.height() / 2.0 - value * yScale - shiftValue; };
+
+    // allowed region
+    QPainterPath envelope;
+    envelope.moveTo(0, yOf(upper[0]));
+    for (int i = 1; i < length; ++i) {
+        envelope.lineTo(i * xScale, yOf(upper[i]));
+    }
+    for (int i = length - 1; i >= 0; --i) {
+        envelope.lineTo(i * xScale, yOf(lower[i]));
+    }
+    envelope.closeSubpath();
+    painter.fillPath(envelope, QColor(180, 220, 180));
+
+    painter.setPen(Qt::darkGreen);
+    const double midY = labelSize.height() / 2.0;
+    painter.drawLine(0, midY, labelSize.width(), midY);
+
+    // latest frame, or the latest failure with its violations marked
+    if (static_cast<int>(lastMaskFrame.size()) == length) {
+        QPainterPath path;
+        path.moveTo(0, yOf(lastMaskFrame[0]));
+        for (int i = 1; i < length; ++i) {
+            path.lineTo(i * xScale, yOf(lastMaskFrame[i]));
+        }
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.setPen(lastMaskFrameFailed ? Qt::red : Qt::black);
+        painter.drawPath(path);
+
+        if (lastMaskFrameFailed) {
+            painter.setPen(QPen(Qt::red, 2));
+            for (int i = 0; i < length; ++i) {
+                if (lastMaskFrame[i] > upper[i] || lastMaskFrame[i] < lower[i]) {
+                    painter.drawEllipse(QPointF(i * xScale, yOf(lastMaskFrame[i])), 2, 2);
+                }
+            }
+        }
+    }
+
+    label->setPixmap(pixmap);
+}
+
+// --------------------------------------------- HISTOGRAM
+
+void MainWindow::onHistogramWindowChanged() {
+    // session, then the last 10 k, 100 k, 1 M or 10 M samples
+    static const qint64 windows[] = {0, 10000, 100000, 1000000, 10000000};
+    histogram.setWindow(windows[qBound(0, ui->histWindowComboBox->currentIndex(), 4)]);
+}
+
+void MainWindow::drawHistogram() {
+    QLabel *label = ui->histLabel;
+    if (histogram.count() == 0) {
+        ui->histStatsLabel->setText("no samples");
+        return;
+    }
+
+    const double mean = histogram.mean();
+    const double sigma = histogram.standardDeviation();
+    ui->histStatsLabel->setText(QString("n %1  mean %2  sd %3  min %4  max %5  p1 %6  p50 %7  p99 %8")
+                                    .arg(histogram.count())
+                                    .arg(mean, 0, 'f', 2)
+                                    .arg(sigma, 0, 'f', 2)
+                                    .arg(histogram.minimum())
+                                    .arg(histogram.maximum())
+                                    .arg(histogram.percentile(0.01))
+                                    .arg(histogram.percentile(0.5))
+                                    .arg(histogram.percentile(0.99)));
+
+    QSize labelSize = label->size();
+    QPixmap pixmap(labelSize);
+    pixmap.fill(Qt::white);
+    QPainter painter(&pixmap);
+
+    const bool logScale = ui->histLogCheckBox->isChecked();
+    auto scaled = [logScale](quint64 count) { return logScale ? std::log10(1.0 + count) : static_cast<double>(count); };
+    const double top = scaled(histogram.largestBin());
+    const double binWidth = labelSize.width() / static_cast<double>(AmplitudeHistogram::kBins);
+    auto xOf = [&](double value) { return (value + 128.0) * binWidth; };
+
+    for (int value = -128; value < 128; ++value) {
+        const quint64 count = histogram.bin(value);
+        if (count == 0) {
+            continue;
+        }
+        const double height = scaled(count) / top * (labelSize.height() - 20);
+        painter.fillRect(QRectF(xOf(value), labelSize.height() - height, binWidth, height), QColor(70, 110, 200));
+    }
+
+    // mean and one standard deviation either side
+    painter.setPen(QPen(Qt::red, 1));
+    painter.drawLine(QPointF(xOf(mean + 0.5), 0), QPointF(xOf(mean + 0.5), labelSize.height()));
+    painter.setPen(QPen(Qt::red, 1, Qt::DashLine));
+    painter.drawLine(QPointF(xOf(mean - sigma + 0.5), 0), QPointF(xOf(mean - sigma + 0.5), labelSize.height()));
+    painter.drawLine(QPointF(xOf(mean + sigma + 0.5), 0), QPointF(xOf(mean + sigma + 0.5), labelSize.height()));
+
+    painter.setPen(Qt::black);
+    painter.drawText(4, 14, "-128");
+    painter.drawText(labelSize.width() / 2 - 4, 14, "0");
+    painter.drawText(labelSize.width() - 30, 14, "127");
+
+    label->setPixmap(pixmap);
+}
+
+// --------------------------------------------- EYE DIAGRAM
+
+void MainWindow::onEyeRunToggled(bool checked) {
+    eyeRunning = checked;
+    if (checked) {
+        onEyeConfigChanged();
+    }
+}
+
+void MainWindow::onEyeConfigChanged() {
+    eyeDiagram.configure(ui->eyeUiSpinBox->value());
+    ui->eyeLabel->clear();
+    ui->eyeStatsLabel->clear();
+}
+
+void MainWindow::drawEye() {
+    QLabel *label = ui->eyeLabel;
+    const double unitInterval = eyeDiagram.unitInterval();
+    QString stats = QString("UI %1 samples (%2 bit/s)  %3")
+                        .arg(unitInterval, 0, 'f', 2)
+                        .arg(currentSampleRate() / unitInterval, 0, 'f', 0)
+                        .arg(eyeDiagram.isLocked() ? "locked" : "searching");
+    const EyeDiagram::Measurement m = eyeDiagram.measure();
+    if (m.open) {
+        stats += QString("  height %1  width %2 UI").arg(m.height).arg(m.width, 0, 'f', 2);
+    } else if (eyeDiagram.sampleCount() > 0) {
+        stats += "  eye closed";
+    }
+    ui->eyeStatsLabel->setText(stats);
+
+    const quint32 peak = eyeDiagram.peak();
+    if (peak == 0) {
+        return;
+    }
+
+    // density on a log scale, blue for single hits up to red for the peak
+    QImage image(EyeDiagram::kColumns, EyeDiagram::kRows, QImage::Format_RGB32);
+    const std::vector<quint32> &density = eyeDiagram.density();
+    const double scale = 1.0 / std::log1p(static_cast<double>(peak));
+    for (int row = 0; row < EyeDiagram::kRows; ++row) {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(row));
+        const quint32 *hits = density.data() + row * EyeDiagram::kColumns;
+        for (int column = 0; column < EyeDiagram::kColumns; ++column) {
+            if (hits[column] == 0) {
+                line[column] = qRgb(255, 255, 255);
+                continue;
+            }
+            const double t = std::log1p(static_cast<double>(hits[column])) * scale;
+            line[column] = QColor::fromHsvF((1.0 - t) * 240.0 / 360.0, 1.0, 1.0).rgb();
+        }
+    }
+
+    QSize labelSize = label->size();
+    QPixmap pixmap(labelSize);
+    pixmap.fill(Qt::white);
+    QPainter painter(&pixmap);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.drawImage(pixmap.rect(), image);
+
+    // decision threshold and the eye centre
+    const double yScale = labelSize.height() / static_cast<double>(EyeDiagram::kRows);
+    const double thresholdY = (127 - eyeDiagram.threshold() + 0.5) * yScale;
+    painter.setPen(QPen(Qt::darkGreen, 1, Qt::DashLine));
+    painter.drawLine(QPointF(0, thresholdY), QPointF(labelSize.width(), thresholdY));
+    painter.drawLine(QPointF(labelSize.width() / 2.0, 0), QPointF(labelSize.width() / 2.0, labelSize.height()));
+
+    label->setPixmap(pixmap);
+}
+
+// --------------------------------------------- WATERFALL
+
+void MainWindow::onSpectrogramRunToggled(bool checked) {
+    spectrogramRunning = checked;
+    if (checked) {
+        spectrogram.reset();
+    }
+}
+
+void MainWindow::onSpectrogramConfigChanged() {
+    // 256 to 4096 points, hop of the whole block down to an eighth of it
+    const int size = 256 << ui->specSizeComboBox->currentIndex();
+    const int hop = size >> ui->specOverlapComboBox->currentIndex();
+    spectrogram.configure(size, hop);
+    onSpectrogramDisplayChanged();
+}
+
+void MainWindow::onSpectrogramDisplayChanged() {
+    spectrogram.setColormap(static_cast<Spectrogram::Colormap>(ui->specColormapComboBox->currentIndex()));
+    spectrogram.setRange(ui->specFloorSpinBox->value(), ui->specTopSpinBox->value());
+    if (spectrogramRunning) {
+        drawSpectrogram();
+    }
+}
+
+void MainWindow::drawSpectrogram() {
+    QLabel *label = ui->specLabel;
+    const QImage &image = spectrogram.image();
+    const int rows = Spectrogram::kRows;
+    const int newest = spectrogram.newestRow();
+
+    QSize labelSize = label->size();
+    QPixmap pixmap(labelSize);
+    QPainter painter(&pixmap);
+
+    // newest row at the top: the ring from newestRow() down, then its wrap
+    const double rowHeight = labelSize.height() / static_cast<double>(rows);
+    const int firstPart = rows - newest;
+    painter.drawImage(QRectF(0, 0, labelSize.width(), firstPart * rowHeight),
+                      image, QRectF(0, newest, image.width(), firstPart));
+    if (newest > 0) {
+        painter.drawImage(QRectF(0, firstPart * rowHeight, labelSize.width(), newest * rowHeight),
+                          image, QRectF(0, 0, image.width(), newest));
+    }
+
+    const double rate = currentSampleRate();
+    painter.setPen(Qt::white);
+    painter.drawText(4, labelSize.height() - 4, "0 Hz");
+    painter.drawText(labelSize.width() / 2 - 30, labelSize.height() - 4, QString("%1 Hz").arg(rate / 4, 0, 'f', 0));
+    painter.drawText(labelSize.width() - 70, labelSize.height() - 4, QString("%1 Hz").arg(rate / 2, 0, 'f', 0));
+    painter.drawText(4, 14, QString("%1 s").arg(rows * spectrogram.hopSize() / rate, 0, 'f', 1));
+
+    label->setPixmap(pixmap);
+}
+
+// --------------------------------------------- FILTER
+
+void MainWindow::appendDisplaySamples(const char *samples, int count) {
+    QVector<qint16> &target = sampledData.channel1;
+    const qint8 *codes = reinterpret_cast<const qint8 *>(samples);
+
+    // averaging takes triggered frames of the stream, which still goes on
+    // to the buffer so the other modes can pick up where it left off
+    if (acquisitionMode == AcquisitionMode::Average) {
+        averageSlicer.feed(codes, count, [this](const qint8 *frame) { frameAverager.add(frame); });
+    }
+
+    const qsizetype first = target.size();
+    appendChainSamples(displayChains[0], codes, count, target);
+
+    // the roll view takes what reached the buffer, as it arrives
+    if (rollMode) {
+        rollView.feed(target.constData() + first, target.size() - first);
+    }
+}
+
+void MainWindow::appendChainSamples(DisplayChain &chain, const qint8 *codes, int count, QVector<qint16> &target) {
+    const bool highRes = acquisitionMode == AcquisitionMode::HighResolution;
+    if (!displayFilterEnabled && chain.decimator.factor() == 1) {
+        if (highRes) {
+            chain.highRes.process(codes, count, target);
+        } else {
+            const qsizetype first = target.size();
+            target.resize(first + count);
+            dsp::widen(codes, count, kSampleFractionBits, target.data() + first);
+        }
+        return;
+    }
+
+    if (highRes) {
+        chain.highResOutput.clear();
+        chain.highRes.process(codes, count, chain.highResOutput);
+        chain.input.resize(chain.highResOutput.size());
+        dsp::scale(chain.highResOutput.constData(), chain.highResOutput.size(), 1.0 / (1 << kSampleFractionBits), 0.0, chain.input.data());
+    } else {
+        chain.input.resize(count);
+        dsp::convert(codes, count, chain.input.data());
+    }
+    const float *in = chain.input.data();
+    size_t n = chain.input.size();
+
+    if (displayFilterEnabled) {
+        chain.filtered.clear();
+        chain.filter.process(in, static_cast<int>(n), chain.filtered);
+        in = chain.filtered.data();
+        n = chain.filtered.size();
+    }
+    if (chain.decimator.factor() > 1) {
+        chain.decimated.clear();
+        chain.decimator.process(in, static_cast<int>(n), chain.decimated);
+        in = chain.decimated.data();
+        n = chain.decimated.size();
+    }
+
+    // back to codes, keeping the fraction
+    const qsizetype first = target.size();
+    target.resize(first + static_cast<qsizetype>(n));
+    dsp::scale(in, static_cast<qsizetype>(n), 1 << kSampleFractionBits, 0.0, target.data() + first);
+}
+
+// both chains from their first sample, so their phases stay in step
+void MainWindow::resetDisplayChains() {
+    for (DisplayChain &chain : displayChains) {
+        chain.highRes.reset();
+        chain.filter.reset();
+        chain.decimator.reset();
+    }
+}
+
+double MainWindow::displaySampleRate() const {
+    double rate = currentSampleRate() / static_cast<double>(displayChains[0].decimator.factor());
+    if (acquisitionMode == AcquisitionMode::HighResolution) {
+        rate /= displayChains[0].highRes.factor();
+    }
+    return rate;
+}
+
+void MainWindow::onFilterChanged() {
+    const double rate = currentSampleRate();
+    const int type = ui->filterTypeComboBox->currentIndex(); // 0 is off
+    ui->filterLowSpinBox->setEnabled(type >= 2);
+    ui->filterHighSpinBox->setEnabled(type == 1 || type >= 3);
+    if (rate <= 0) {
+        return; // the source is still reading its format, ready() comes back here
+    }
+
+    // a new factor is a new sample rate, older samples would not line up
+    const int factor = ui->decimateSpinBox->value();
+    const bool rateChanged = factor != displayChains[0].decimator.factor();
+    displayFilterEnabled = type > 0;
+
+    std::vector<float> taps;
+    if (displayFilterEnabled) {
+        taps = FirFilter::design(static_cast<FirFilter::Type>(type - 1),
+                                 ui->filterTapsSpinBox->value(),
+                                 ui->filterLowSpinBox->value() / rate,
+                                 ui->filterHighSpinBox->value() / rate,
+                                 static_cast<FirFilter::Window>(ui->filterWindowComboBox->currentIndex()));
+    }
+    for (DisplayChain &chain : displayChains) {
+        chain.decimator.configure(factor);
+        if (displayFilterEnabled) {
+            chain.filter.setTaps(taps);
+        }
+    }
+    resetDisplayChains();
+    if (rateChanged) {
+        sampledData.channel1.clear();
+        sampledData.channel2.clear();
+    }
+
+    QString status;
+    const FirFilter &filter = displayChains[0].filter;
+    if (displayFilterEnabled) {
+        status = filter.isDirect()
+            ? QString("%1 taps, direct").arg(filter.tapCount())
+            : QString("%1 taps, overlap-save with %2 point FFT").arg(filter.tapCount()).arg(filter.fftSize());
+        drawFilterResponse(taps);
+    } else {
+        ui->filterResponseLabel->setText("Filter off");
+    }
+    if (factor > 1) {
+        status += QString("%1display rate %2 Hz").arg(status.isEmpty() ? "" : ", ").arg(rate / factor, 0, 'f', 0);
+    }
+    ui->filterStatusLabel->setText(status);
+}
+
+void MainWindow::drawFilterResponse(const std::vector<float> &taps) {
+    QLabel *label = ui->filterResponseLabel;
+
+    // magnitude from the zero padded kernel, 0 to half the sample rate
+    Fft fft(Fft::nextPowerOfTwo(std::max<int>(4096, static_cast<int>(taps.size()))));
+    std::vector<Complex> spectrum(fft.size(), Complex(0.0f, 0.0f));
+    std::copy(taps.begin(), taps.end(), spectrum.begin());
+    fft.forward(spectrum.data());
+
+    QSize labelSize = label->size();
+    QPixmap pixmap(labelSize);
+    pixmap.fill(Qt::white);
+    QPainter painter(&pixmap);
+
+    const double floorDb = -100.0;
+    const double topDb = 10.0;
+    const int bins = fft.size() / 2;
+    auto yOf = [&](double db) {
+        return (topDb - qBound(floorDb, db, topDb)) / (topDb - floorDb) * labelSize.height();
+    };
+
+    painter.setPen(QPen(Qt::lightGray, 1, Qt::DashLine));
+    for (double db = 0.0; db > floorDb; db -= 20.0) {
+        painter.drawLine(QPointF(0, yOf(db)), QPointF(labelSize.width(), yOf(db)));
+        painter.drawText(QPointF(4, yOf(db) - 2), QString("%1 dB").arg(db));
+    }
+
+    QPainterPath path;
+    for (int bin = 0; bin < bins; ++bin) {
+        const double db = 20.0 * std::log10(std::abs(spectrum[bin]) + 1e-12);
+        const QPointF point(bin * labelSize.width() / static_cast<double>(bins), yOf(db));
+        if (bin == 0) {
+            path.moveTo(point);
+        } else {
+            path.lineTo(point);
+        }
+    }
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(QPen(Qt::blue, 1.5));
+    painter.drawPath(path);
+
+    label->setPixmap(pixmap);
+}
+
+// --------------------------------------------- ACQUISITION MODES
+
+void MainWindow::onAcquisitionModeChanged() {
+    const AcquisitionMode mode = static_cast<AcquisitionMode>(ui->acqModeComboBox->currentIndex());
+    const int count = ui->acqCountSpinBox->value();
+    ui->acqCountSpinBox->setEnabled(mode != AcquisitionMode::Normal);
+    ui->acqCountSpinBox->setSuffix(mode == AcquisitionMode::HighResolution ? " samples" : " frames");
+
+    // frames start at a rising edge through the locking level, a quarter
+    // of the frame before it like the mask test
+    const int length = ui->sampleSizeSpinner->value();
+    averageSlicer.configure(ui->lockingLevelSlider->value(), TriggerSlicer::Edge::Rising, length, length / 4);
+    if (mode == AcquisitionMode::Average) {
+        frameAverager.configure(length, count);
+    } else {
+        frameAverager.configure(1, 1); // lets go of the ring
+    }
+
+    // a new factor is a new sample rate, older samples would not line up
+    const int factor = mode == AcquisitionMode::HighResolution ? count : 1;
+    if (factor != displayChains[0].highRes.factor()) {
+        for (DisplayChain &chain : displayChains) {
+            chain.highRes.configure(factor, kSampleFractionBits);
+        }
+        resetDisplayChains();
+        sampledData.channel1.clear();
+        sampledData.channel2.clear();
+    }
+
+    if (mode != acquisitionMode) {
+        const QString names[] = {"normal", "average", "high resolution"};
+        logInfo("Acquisition mode: " + names[static_cast<int>(mode)]);
+    }
+    acquisitionMode = mode;
+}
+
+// --------------------------------------------- ROLL
+
+void MainWindow::onRollModeChanged() {
+    const bool roll = ui->rollCheckBox->isChecked();
+    ui->rollSpanSpinBox->setEnabled(roll);
+    if (roll != rollMode) {
+        rollView.configure(QSize(), 1); // the next frame starts a fresh image
+        logInfo(roll ? "Roll mode on" : "Roll mode off");
+    }
+    rollMode = roll;
+}
+
+// Channel 1 as a chart recorder, the newest samples at the right edge. The
+// plot is kept in rollPixmap; a frame scrolls it by the columns the samples
+// since the last frame completed and paints only those, and the corner the
+// span is written in.
+void MainWindow::drawRoll(const FrameSettings &settings) {
+    PERF_SCOPE(PerfStage::Draw);
+    QLabel *label = ui->sineWaveLabel;
+    const QSize labelSize = label->size();
+
+    // the span across the plot at the rate the samples reach the display
+    const double rate = displaySampleRate();
+    const double span = ui->rollSpanSpinBox->value();
+    const int perColumn = qMax(1, qRound(span * rate / qMax(labelSize.width(), 1)));
+    bool changed = rollView.configure(labelSize, perColumn);
+
+    // the scale drawWaveform() uses, for samples with their fraction bits
+    const double yScale = (labelSize.height() / 2.0) / settings.zoom;
+    const double unit = 1 << kSampleFractionBits;
+    changed |= rollView.setScale(-yScale / unit, labelSize.height() / 2.0 - settings.shift, settings.lockingLevel * unit);
+
+    const int columns = rollView.render();
+    changed |= rollPixmap.size() != labelSize;
+    if (columns == 0 && !changed) {
+        return;
+    }
+
+    // the label lets go of its copy first, so the scroll works in place
+    // instead of detaching a full copy of the plot
+    label->setPixmap(QPixmap());
+    if (changed) {
+        rollPixmap = QPixmap(labelSize);
+    } else {
+        rollPixmap.scroll(-columns, 0, rollPixmap.rect());
+    }
+    QPainter painter(&rollPixmap);
+    if (changed) {
+        rollView.paint(painter, 0, labelSize.width());
+    } else {
+        rollView.paint(painter, labelSize.width() - columns, columns);
+        rollView.paint(painter, 0, kRollTextWidth); // the text scrolled too
+    }
+    painter.setPen(Qt::black);
+    painter.drawText(QPointF(5, 20), QString("Roll: %1 s").arg(span));
+    painter.end();
+    label->setPixmap(rollPixmap);
+}
+
+// --------------------------------------------- REFERENCES
+
+void MainWindow::onReferenceStore() {
+    const QVector<double> &trace = waveformData.channel1;
+    if (trace.isEmpty()) {
+        logInfo("Error: There is no channel 1 trace to store");
+        return;
+    }
+    QString name = ui->refNameEdit->text().trimmed();
+    if (name.isEmpty()) {
+        name = referenceLibrary.nextName();
+    }
+    const bool replaced = referenceLibrary.indexOf(name) >= 0;
+    // the rate of the trace, after high resolution and decimation
+    referenceLibrary.add(name, trace.constData(), trace.size(), qRound(displaySampleRate()));
+    ui->refNameEdit->clear();
+    updateReferenceTable();
+    logInfo(QString("Reference %1 %2, %3 samples").arg(name, replaced ? "replaced" : "stored").arg(trace.size()));
+}
+
+void MainWindow::onReferenceRemove() {
+    referenceLibrary.removeAt(ui->refTableWidget->currentRow());
+    referenceDifference = ReferenceLibrary::Difference();
+    updateReferenceTable();
+}
+
+void MainWindow::onReferenceSave() {
+    if (referenceLibrary.count() == 0) {
+        logInfo("Error: There are no references to save");
+        return;
+    }
+    const QString fileName = QFileDialog::getSaveFileName(this, tr("Save References"), "", tr("Reference Libraries (*.rref);;All Files (*)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+    if (!referenceLibrary.save(fileName, ui->refCompressCheckBox->isChecked())) {
+        logInfo("ERROR: cannot write " + fileName + ". " + referenceLibrary.errorString());
+        return;
+    }
+    logInfo(QString("Saved %1 references to %2 (%3 bytes)")
+                .arg(referenceLibrary.count())
+                .arg(fileName)
+                .arg(QFileInfo(fileName).size()));
+}
+
+void MainWindow::onReferenceLoad() {
+    const QString fileName = QFileDialog::getOpenFileName(this, tr("Load References"), "", tr("Reference Libraries (*.rref);;All Files (*)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+    if (!referenceLibrary.load(fileName)) {
+        logInfo("ERROR: cannot load " + fileName + ". " + referenceLibrary.errorString());
+        return;
+    }
+    updateReferenceTable();
+    logInfo("Loaded references from " + fileName);
+}
+
+void MainWindow::onReferenceItemChanged(QTableWidgetItem *item) {
+    if (item->column() == 0) {
+        referenceLibrary.setVisible(item->row(), item->checkState() == Qt::Checked);
+    }
+}
+
+void MainWindow::updateReferenceTable() {
+    QTableWidget *table = ui->refTableWidget;
+    const QSignalBlocker blocker(table);
+    table->setRowCount(referenceLibrary.count());
+
+    for (int row = 0; row < referenceLibrary.count(); ++row) {
+        const ReferenceLibrary::Reference &reference = referenceLibrary.at(row);
+        const QStringList cells = {reference.name, QString::number(reference.size()), QString("%1 Hz").arg(reference.sampleRate)};
+        for (int column = 0; column < cells.size(); ++column) {
+            QTableWidgetItem *item = table->item(row, column);
+            if (!item) {
+                item = new QTableWidgetItem;
+                item->setTextAlignment(Qt::AlignCenter);
+                table->setItem(row, column, item);
+            }
+            item->setText(cells[column]);
+        }
+
+        // the name carries the overlay's colour and its on/off box
+        QTableWidgetItem *name = table->item(row, 0);
+        name->setFlags(name->flags() | Qt::ItemIsUserCheckable);
+        name->setCheckState(reference.visible ? Qt::Checked : Qt::Unchecked);
+        name->setForeground(kReferenceColors[row % kReferenceColorCount]);
+    }
+
+    ui->refStatsLabel->setText(QString("%1 references, %2 KiB of samples")
+                                   .arg(referenceLibrary.count())
+                                   .arg(referenceLibrary.sampleBytes() / 1024.0, 0, 'f', 1));
+}
+
+// Visible references under the live channel 1 trace, on the same scales.
+// With locking on each one starts at its own first lock edge, so it lines
+// up with the live trace the way a stored scope trace would. The samples
+// are read in place out of the library.
+void MainWindow::drawReferences(QPainter &painter, QSize labelSize, const QVector<double> &data, int liveStart, const FrameSettings &settings) {
+    const double xScale = labelSize.width() / static_cast<double>(std::max<qsizetype>(data.size() - 1, 1));
+    const double yScale = (labelSize.height() / 2.0) / settings.zoom;
+    const double midY = labelSize.height() / 2.0 - settings.shift;
+    const int selected = ui->refTableWidget->currentRow();
+    referenceDifference = ReferenceLibrary::Difference();
+
+    for (int r = 0; r < referenceLibrary.count(); ++r) {
+        const ReferenceLibrary::Reference &reference = referenceLibrary.at(r);
+        if (reference.size() == 0 || (!reference.visible && r != selected)) {
+            continue;
+        }
+
+        int start = 0;
+        if (settings.locking) {
+            referenceFlags.resize(reference.size());
+            dsp::markEdges<dsp::Edge::Lock>(reference.data(), reference.size(), settings.lockingLevel, referenceFlags.data());
+            start = std::max(0, static_cast<int>(dsp::firstFlag(referenceFlags.data(), 1, reference.size())));
+        }
+
+        if (r == selected) {
+            referenceDifference = ReferenceLibrary::compare(data.constData(), data.size(), liveStart,
+                                                            reference.data(), reference.size(), start);
+        }
+        if (!reference.visible) {
+            continue;
+        }
+
+        // only what fits on the plot
+        const int count = std::min(reference.size() - start, static_cast<int>(labelSize.width() / xScale) + 2);
+        overlayPoints.resize(count);
+        const qint8 *samples = reference.data() + start;
+        for (int i = 0; i < count; ++i) {
+            overlayPoints[i] = QPointF(i * xScale, midY - samples[i] * yScale);
+        }
+        painter.setPen(QPen(kReferenceColors[r % kReferenceColorCount], 1));
+        painter.drawPolyline(overlayPoints.constData(), count);
+    }
+}
+
+// --------------------------------------------- RECORD AND EXPORT
+
+void MainWindow::onRecordToggled(bool checked) {
+    if (checked) {
+        QString fileName = QFileDialog::getSaveFileName(this,
+                                                        tr("Record Capture"), "",
+                                                        tr("Capture Files (*.rcap)"));
+        if (fileName.isEmpty()) {
+            ui->recordCheckBox->setChecked(false);
+            return;
+        }
+
+        if (!captureWriter.open(fileName, currentSampleRate())) {
+            logInfo("ERROR: cannot open " + fileName + ". " + captureWriter.errorString());
+            ui->recordCheckBox->setChecked(false);
+            return;
+        }
+        capturePath = fileName;
+        logInfo("Recording to " + fileName);
+    } else if (captureWriter.isOpen()) {
+        captureWriter.close();
+        logInfo("Recorded " + QString::number(captureWriter.sampleCount()) + " samples to " + capturePath);
+    }
+}
+
+void MainWindow::onExport() {
+    const int source = ui->exportSourceComboBox->currentIndex();
+    QString captureSource;
+    WaveformData frame;
+
+    if (source == 0) {
+        frame = waveformData;
+    } else if (source == 1) {
+        frame = snapShotData;
+    } else {
+        if (capturePath.isEmpty()) {
+            logInfo("Error: Nothing has been recorded yet");
+            return;
+        }
+        if (captureWriter.isOpen()) {
+            logInfo("Error: Stop recording before exporting the capture");
+            return;
+        }
+        captureSource = capturePath;
+    }
+
+    if (captureSource.isEmpty() && frame.channel1.isEmpty()) {
+        logInfo("Error: There is no data to export");
+        return;
+    }
+
+    QString fileName = QFileDialog::getSaveFileName(this,
+                                                    tr("Export Waveform"), "",
+                                                    tr("CSV Files (*.csv);;WAV Files (*.wav);;Binary Capture (*.rcap)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    ui->exportButton->setEnabled(false);
+    ui->exportCancelButton->setEnabled(true);
+    ui->exportProgressBar->setValue(0);
+    logInfo("Exporting to " + fileName);
+
+    // queued so the whole export runs on the exporter thread, a cancel from
+    // here on stops it even before it starts
+    WaveformExporter *target = exporter;
+    target->queued();
+    // a frame is at the display rate, a capture carries the raw one
+    const quint32 sampleRate = qRound(displaySampleRate());
+    if (captureSource.isEmpty()) {
+        QMetaObject::invokeMethod(target, [target, frame, sampleRate, fileName]() {
+            target->exportFrame(frame.channel1, frame.channel2, sampleRate, fileName);
+        }, Qt::QueuedConnection);
+    } else {
+        QMetaObject::invokeMethod(target, [target, captureSource, fileName]() {
+            target->exportCapture(captureSource, fileName);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void MainWindow::onExportProgress(qint64 done, qint64 total) {
+    if (total > 0) {
+        ui->exportProgressBar->setValue(static_cast<int>(done * 1000 / total));
+    }
+}
+
+void MainWindow::onExportFinished(bool ok, const QString &message) {
+    ui->exportButton->setEnabled(true);
+    ui->exportCancelButton->setEnabled(false);
+    ui->exportProgressBar->setValue(ok ? 1000 : 0);
+    logInfo(message);
+}
+
+// --------------------------------------------- STATS
+
+void MainWindow::updateStats() {
+    if (framedStream) {
+        // effective rate and loss over the last refresh interval
+        const FrameParser::Stats &stream = frameParser.stats();
+        const double seconds = statsTimer->interval() / 1000.0;
+        const quint64 frames = stream.frames - lastStreamStats.frames;
+        const quint64 lost = stream.lostFrames - lastStreamStats.lostFrames;
+        const double lossPercent = frames + lost > 0 ? 100.0 * lost / (frames + lost) : 0.0;
+
+        ui->streamStatsLabel->setText(QString("%1 S/s  %2 frames/s  loss %3%\nlost %4  jumps %5  resyncs %6  bad %7  skipped %8 B")
+                                          .arg((stream.samples - lastStreamStats.samples) / seconds, 0, 'f', 0)
+                                          .arg(frames / seconds, 0, 'f', 0)
+                                          .arg(lossPercent, 0, 'f', 2)
+                                          .arg(stream.lostFrames)
+                                          .arg(stream.sequenceJumps)
+                                          .arg(stream.resyncs)
+                                          .arg(stream.badChecksums)
+                                          .arg(stream.discardedBytes));
+        lastStreamStats = stream;
+    }
+
+    if (maskTest.isReady()) {
+        const quint64 total = maskTest.passCount() + maskTest.failCount();
+        ui->maskStatsLabel->setText(QString("%1 frames  %2 passed  %3 failed  (%4% fail)%5")
+                                        .arg(total)
+                                        .arg(maskTest.passCount())
+                                        .arg(maskTest.failCount())
+                                        .arg(total > 0 ? 100.0 * maskTest.failCount() / total : 0.0, 0, 'f', 3)
+                                        .arg(maskRunning ? "" : "  stopped"));
+    } else if (maskLearning) {
+        ui->maskStatsLabel->setText(QString("Learning %1/%2").arg(maskTest.learnedFrames()).arg(kMaskLearnFrames));
+    }
+
+#ifdef RICHARDUINO_PERF
+    PerfStats &stats = PerfStats::instance();
+    stats.updateRates();
+    perfOverlayText = stats.report();
+    ui->statsLabel->setText(perfOverlayText);
+#endif
+}
+
+void MainWindow::onDumpStats() {
+    QString fileName = QFileDialog::getSaveFileName(this,
+                                                    tr("Dump Stats"), "",
+                                                    tr("CSV Files (*.csv);;All Files (*)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    if (PerfStats::instance().dump(fileName)) {
+        logInfo("Stats written to " + fileName);
+    } else {
+        logInfo("ERROR: cannot write stats to " + fileName);
+    }
+}
+
+void MainWindow::onResetStats() {
+    PerfStats::instance().reset();
+    logInfo("Stats reset");
+}
+
+// --------------------------------------------- PEEK, POKE AND VERSION
+
+void MainWindow::onPoke(const QString &addressStr, const QString &dataStr, bool isHex, bool debug) {
+    if (isConnected().isEmpty()) {
+        logInfo("Error: There is no comm port connection");
+        return;
+    }
+
+    bool okAddress, okData;
+    uint32_t address = addressStr.toUInt(&okAddress, 16); // Address is always hex
+    if(!okAddress){
+        logInfo("invalid address format");
+    }
+
+    uint32_t data;
+
+    if (isHex) {
+        data = dataStr.toUInt(&okData, 16);
+    } else {
+        data = dataStr.toUInt(&okData);
+        // Check if data exceeds 32 bits after conversion to hex
+        if (okData && QString::number(data, 16).length() > 8) {
+            logInfo("Data exceeds 32 bits");
+            return;
+        }
+    }
+
+    if (!okData) {
+        logInfo("Invalid Data format");
+        return;
+    }
+
+
+    Poke poke(&serial);
+    poke.execute(address, data);
+
+    // Log message in both decimal and hex
+    QString decimalData = QString::number(data);
+    QString hexData = QString::number(data, 16).toUpper();
+    if (debug){
+        QString messageLog = QString("Sent: Address = 0x%1, Data = %2 (0x%3)").arg(addressStr, decimalData, hexData);
+        logInfo(messageLog);
+    }
+}
+
+void MainWindow::onPeek(const QString &addressStr, bool debug) {
+    if (isConnected().isEmpty()) {
+        logInfo("Error: There is no comm port connection");
+        return;
+    }
+
+    if (isSampling) {
+        logInfo("Error: Cannot peek while sampling is active");
+        return;
+    }
+
+    bool ok;
+    uint64_t longAddress = addressStr.toULongLong(&ok, 16);
+    uint32_t address = static_cast<uint32_t>(longAddress);
+    if (!ok) {
+        logInfo("Invalid address format");
+        return;
+    }
+
+    // queued behind the memory browser's and the watch list's reads, so the
+    // reply can never be taken for one of theirs; a timeout is logged by the
+    // pipeline's failed handler
+    const int ticket = peekPipeline->read(address, 1);
+    if (debug) {
+        peekTicket = ticket;
+    }
+}
+
+void MainWindow::onVersion() {
+    if (isConnected().isEmpty()) {
+        logInfo("Error: There is no comm port connection");
+        return;
+    }
+
+    // not a read the pipeline can queue, so the port is cleared of its
+    // replies before the blocking command reads it
+    peekPipeline->drain();
+    Version version(&serial);
+    QByteArray response = version.execute();
+
+    if (!response.isEmpty()) {
         logInfo("Version: " + QString(response[0]));
     } else {
         logInfo("No response received for version request");
@@ -780,16 +2407,62 @@ void MainWindow::onBrowseFile() {
 }
 
 void MainWindow::onRefreshCOMPorts() {
-    ui->comPortComboBox->clear(); // Clear existing items
     logInfo("refreshed");
+    portWatcher.rescan();
+}
 
-    QList<QSerialPortInfo> ports = QSerialPortInfo::availablePorts();
-    for (const QSerialPortInfo &port : ports) {
-        // Assuming you want to exclude Bluetooth ports from the list
-        if (!port.description().contains("Standard Serial over Bluetooth link", Qt::CaseInsensitive)) {
-            ui->comPortComboBox->addItem(port.portName()); // Use ui-> to access comPortComboBox
+void MainWindow::onPortAdded(const PortEntry &port) {
+    // keep the list sorted and the current selection where it is
+    int index = 0;
+    while (index < ui->comPortComboBox->count() && ui->comPortComboBox->itemText(index) < port.name) {
+        index++;
+    }
+    ui->comPortComboBox->insertItem(index, port.name);
+
+    if (reconnectPending && ui->autoReconnectCheckBox->isChecked() && !serial.isOpen() && port.sameDevice(connectedPort)) {
+        logInfo("Board is back on " + port.name + ", reconnecting");
+        reconnectPending = false;
+        ui->comPortComboBox->setCurrentIndex(index);
+        initializeSerialCommunication();
+        if (serial.isOpen() && resumeSampling && ui->sourceComboBox->currentIndex() == 0) {
+            onStartStopSampling();
         }
+        resumeSampling = false;
+    }
+}
+
+void MainWindow::onPortRemoved(const PortEntry &port) {
+    const int index = ui->comPortComboBox->findText(port.name);
+    if (index >= 0) {
+        ui->comPortComboBox->removeItem(index);
+    }
+    if (serial.isOpen() && serial.portName() == port.name) {
+        connectionLost();
+    }
+}
+
+void MainWindow::onSerialError(QSerialPort::SerialPortError error) {
+    // ResourceError is what an unplugged adapter looks like
+    if (error == QSerialPort::ResourceError && serial.isOpen()) {
+        connectionLost();
+    }
+}
+
+void MainWindow::connectionLost() {
+    logInfo("Lost the connection to " + serial.portName());
+    resumeSampling = isSampling && ui->sourceComboBox->currentIndex() == 0;
+
+    // the device is gone, nothing to turn off: closed first, so stopping
+    // the stream and the pending peeks writes nothing to the dead handle
+    serial.close();
+    if (isSampling) {
+        stopSampling();
     }
+    peekPipeline->cancel();
+    memoryDumpPath.clear();
+    ui->connectButton->setText("Connect");
+    ui->connectButton->setStyleSheet("color: red; background-color: white;");
+    reconnectPending = true;
 }
 
 void MainWindow::onUpdateFirmware() {
@@ -801,21 +2474,250 @@ void MainWindow::onUpdateFirmware() {
     updater->updateFirmware(serial);
 }
 
+// --------------------------------------------- MEMORY BROWSER
+
+void MainWindow::onMemoryGo() {
+    bool ok;
+    const quint32 base = ui->memAddressEdit->text().toUInt(&ok, 16);
+    if (!ok) {
+        logInfo("Invalid address format");
+        return;
+    }
+
+    // 256 B, 4 KB, 64 KB, 1 MB, 16 MB, never past the top of the address space
+    const quint64 size = qMin<quint64>(256ull << (4 * ui->memSizeComboBox->currentIndex()), 0x100000000ull - base);
+
+    peekPipeline->cancel();
+    memoryDumpPath.clear();
+    memoryModel->setRange(base, static_cast<quint32>(size));
+    ui->memTableView->scrollToTop();
+    onMemoryPageLoaded();
+}
+
+void MainWindow::onMemoryRefresh() {
+    peekPipeline->cancel();
+    memoryDumpPath.clear();
+    memoryModel->refresh();
+    onMemoryPageLoaded();
+}
+
+void MainWindow::onMemoryDump() {
+    if (isConnected().isEmpty()) {
+        logInfo("Error: There is no comm port connection");
+        return;
+    }
+    if (isSampling) {
+        logInfo("Error: Cannot peek while sampling is active");
+        return;
+    }
+    if (memoryModel->size() == 0) {
+        onMemoryGo();
+    }
+
+    QString fileName = QFileDialog::getSaveFileName(this,
+                                                    tr("Dump Memory"), "",
+                                                    tr("Binary Files (*.bin);;All Files (*)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    // everything not cached yet is queued in one go, the file is written
+    // once the last page has come in
+    memoryDumpPath = fileName;
+    memoryDumpClock.start();
+    memoryModel->fetchAll();
+    onMemoryPageLoaded();
+}
+
+void MainWindow::onMemoryPageLoaded() {
+    const int loaded = memoryModel->loadedPages();
+    const int total = memoryModel->pageCount();
+    ui->memStatusLabel->setText(QString("%1 / %2 pages").arg(loaded).arg(total));
+
+    if (memoryDumpPath.isEmpty() || loaded < total) {
+        return;
+    }
+
+    const QString fileName = memoryDumpPath;
+    memoryDumpPath.clear();
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(memoryModel->bytes()) != memoryModel->size()) {
+        logInfo("ERROR: cannot write " + fileName + ". " + file.errorString());
+        return;
+    }
+    logInfo(QString("Dumped %1 bytes from 0x%2 in %3 ms")
+                .arg(memoryModel->size())
+                .arg(QString::number(memoryModel->base(), 16).toUpper())
+                .arg(memoryDumpClock.elapsed()));
+}
+
+// --------------------------------------------- REGISTER WATCH
+
+void MainWindow::onWatchAdd() {
+    bool ok;
+    const quint32 address = ui->watchAddressEdit->text().toUInt(&ok, 16);
+    if (!ok) {
+        logInfo("Invalid address format");
+        return;
+    }
+    if (!registerWatch->add(address)) {
+        logInfo("Error: " + QString::number(address, 16).toUpper() + " is already watched");
+        return;
+    }
+    updateWatchTable();
+}
+
+void MainWindow::onWatchRemove() {
+    registerWatch->removeAt(ui->watchTableWidget->currentRow());
+    updateWatchTable();
+    drawWatchPlot();
+}
+
+void MainWindow::onWatchRunToggled(bool checked) {
+    if (!checked) {
+        registerWatch->stop();
+        return;
+    }
+    if (isConnected().isEmpty()) {
+        logInfo("Error: There is no comm port connection");
+        ui->watchRunCheckBox->setChecked(false);
+        return;
+    }
+    registerWatch->start();
+}
+
+void MainWindow::onWatchPolled() {
+    updateWatchTable();
+    ui->watchStatusLabel->setText(QString("poll %1 ms, stream paused %2 ms")
+                                      .arg(registerWatch->lastPollMs())
+                                      .arg(registerWatch->lastPauseMs()));
+    if (ui->tabWidget->currentWidget() == ui->tab_watch) {
+        drawWatchPlot();
+    }
+}
+
+void MainWindow::updateWatchTable() {
+    QTableWidget *table = ui->watchTableWidget;
+    const qint64 now = registerWatch->elapsed();
+    table->setRowCount(registerWatch->count());
+
+    for (int row = 0; row < registerWatch->count(); ++row) {
+        const RegisterWatch::Entry &entry = registerWatch->at(row);
+        const QString value = entry.valid ? QString("%1").arg(entry.value, 8, 16, QChar('0')).toUpper() : QString("--------");
+        const QString changed = entry.changes > 0
+            ? QString("%1 s ago").arg((now - entry.history.last().time) / 1000.0, 0, 'f', 1)
+            : QString();
+
+        const QStringList cells = {QString("%1").arg(entry.address, 8, 16, QChar('0')).toUpper(), value, QString::number(entry.changes), changed};
+        for (int column = 0; column < cells.size(); ++column) {
+            QTableWidgetItem *item = table->item(row, column);
+            if (!item) {
+                item = new QTableWidgetItem;
+                item->setTextAlignment(Qt::AlignCenter);
+                table->setItem(row, column, item);
+            }
+            item->setText(cells[column]);
+        }
+
+        // changed since the previous poll
+        table->item(row, 1)->setBackground(entry.changedLastPoll ? QColor(255, 230, 120) : QColor(Qt::white));
+    }
+}
+
+void MainWindow::drawWatchPlot() {
+    QLabel *label = ui->watchPlotLabel;
+    const int row = ui->watchTableWidget->currentRow();
+    if (row < 0 || row >= registerWatch->count() || registerWatch->at(row).history.isEmpty()) {
+        label->setText("Select a register to plot");
+        return;
+    }
+    const RegisterWatch::Entry &entry = registerWatch->at(row);
+    const QVector<RegisterWatch::Change> &history = entry.history;
+
+    // the last kWatchPlotMs, as steps from one change to the next
+    const qint64 now = registerWatch->elapsed();
+    const qint64 from = now - kWatchPlotMs;
+    int first = history.size() - 1;
+    while (first > 0 && history[first].time > from) {
+        first--;
+    }
+    quint32 low = history[first].value;
+    quint32 high = low;
+    for (int i = first; i < history.size(); ++i) {
+        low = qMin(low, history[i].value);
+        high = qMax(high, history[i].value);
+    }
+
+    QSize labelSize = label->size();
+    QPixmap pixmap(labelSize);
+    pixmap.fill(Qt::white);
+    QPainter painter(&pixmap);
+
+    const double margin = 20.0;
+    const double xScale = labelSize.width() / static_cast<double>(kWatchPlotMs);
+    const double span = high > low ? static_cast<double>(high - low) : 1.0;
+    auto xOf = [&](qint64 time) { return qMax(0.0, (time - from) * xScale); };
+    auto yOf = [&](quint32 value) {
+        return labelSize.height() - margin - (value - low) / span * (labelSize.height() - 2 * margin);
+    };
+
+    QPainterPath path;
+    path.moveTo(xOf(history[first].time), yOf(history[first].value));
+    for (int i = first + 1; i < history.size(); ++i) {
+        path.lineTo(xOf(history[i].time), yOf(history[i - 1].value));
+        path.lineTo(xOf(history[i].time), yOf(history[i].value));
+    }
+    path.lineTo(xOf(now), yOf(history.last().value));
+    painter.setPen(QPen(Qt::blue, 2));
+    painter.drawPath(path);
+
+    painter.setPen(Qt::black);
+    painter.drawText(4, 14, QString("%1").arg(high, 8, 16, QChar('0')).toUpper());
+    painter.drawText(4, labelSize.height() - 4, QString("%1").arg(low, 8, 16, QChar('0')).toUpper());
+    painter.drawText(labelSize.width() - 60, labelSize.height() - 4, QString("%1 s").arg(kWatchPlotMs / 1000));
+
+    label->setPixmap(pixmap);
+}
+
 // --------------------------------------------- LOG
 
 void MainWindow::updateStatusLabel(const QString &status) {
-    ui->logConsole->appendPlainText(status);
+    logSink.post(status, false);
 
 }
 
 void MainWindow::logInfo(const QString &message) {
-    QString timestamp = QDateTime::currentDateTime().toString("HH:mm");
-    ui->logConsole->appendPlainText(timestamp + ": " + message);
+    // timestamped and appended on the next flush, never here
+    logSink.post(message);
 }
 
 void MainWindow::onClear(){
     //clears log
-    ui->logConsole->clear();
+    logSink.clear();
+}
+
+void MainWindow::onLogFileToggled(bool checked) {
+    if (!checked) {
+        logSink.closeLogFile();
+        return;
+    }
+
+    QString fileName = QFileDialog::getSaveFileName(this,
+                                                    tr("Log File"), "",
+                                                    tr("Log Files (*.log *.txt);;All Files (*)"));
+    if (fileName.isEmpty()) {
+        ui->logFileCheckBox->setChecked(false);
+        return;
+    }
+
+    QString error;
+    if (!logSink.setLogFile(fileName, &error)) {
+        logInfo("ERROR: cannot open " + fileName + ". " + error);
+        ui->logFileCheckBox->setChecked(false);
+        return;
+    }
+    logInfo("Logging to " + fileName);
 }
 
 // --------------------------------------------- COMM
@@ -823,18 +2725,19 @@ void MainWindow::onClear(){
 void MainWindow::initializeSerialCommunication() {
     if (serial.isOpen()) {
 
-        turnOffBoard();
+        if (isSampling) {
+            stopSampling();
+        }
 
-        isSampling = false;
-        ui->startSampling->setText("Start Sampling");
-        logInfo("..... STOPPING .....");
-        disconnect(&serial, &QSerialPort::readyRead, this, &MainWindow::Sampling);
+        turnOffBoard();
 
         ui->connectButton->setText("Connect");
         ui->connectButton->setStyleSheet("color: red; background-color: white;");
         logInfo("Disconnected from "+ serial.portName());
+        reconnectPending = false;
 
-
+        peekPipeline->cancel();
+        memoryDumpPath.clear();
         serial.close();
 
     } else {
@@ -842,6 +2745,16 @@ void MainWindow::initializeSerialCommunication() {
         serial.setBaudRate(921600);
 
         if (serial.open(QIODevice::ReadWrite)) {
+            // remembered so the same adapter is found again if it re-enumerates
+            connectedPort = PortEntry();
+            connectedPort.name = serial.portName();
+            for (const PortEntry &port : portWatcher.ports()) {
+                if (port.name == connectedPort.name) {
+                    connectedPort = port;
+                }
+            }
+            reconnectPending = false;
+
             ui->connectButton->setText("Disconnect");
             ui->connectButton->setStyleSheet("color: green; background-color: white;");
             logInfo("Connected to " + serial.portName());
@@ -889,13 +2802,25 @@ void MainWindow::onZoomIn() {
 MainWindow::~MainWindow()
 {
 
-    if (serial.isOpen()) {
-        disconnect(&serial, &QSerialPort::readyRead, this, &MainWindow::Sampling);
+    if (isSampling) {
+        stopSampling();
+    }
 
+    if (serial.isOpen()) {
+        peekPipeline->cancel();
         turnOffBoard();
 
         serial.close();
     }
 
+    captureWriter.close();
+    maskFailWriter.close();
+    sharedStream.close();
+    remoteThread.quit();
+    remoteThread.wait();
+    exporter->cancel();
+    exportThread.quit();
+    exportThread.wait();
+
     delete ui;
 }
@@ -5,6 +5,30 @@
 #include <QLabel>
 #include <QMainWindow>
 #include <QSerialPort>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QPointF>
+#include "capturefile.h"
+#include "samplesource.h"
+#include "frameparser.h"
+#include "sincinterpolator.h"
+#include "mathchannel.h"
+#include "triggerslicer.h"
+#include "masktest.h"
+#include "sharedstream.h"
+#include "remoteserver.h"
+#include "portwatcher.h"
+#include "logsink.h"
+#include "memorybrowser.h"
+#include "registerwatch.h"
+#include "amplitudehistogram.h"
+#include "eyediagram.h"
+#include "spectrogram.h"
+#include "firfilter.h"
+#include "dspkernels.h"
+#include "referencelibrary.h"
+#include "acquisitionmodes.h"
+#include "rollview.h"
 
 
 
@@ -12,6 +36,10 @@ QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
 QT_END_NAMESPACE
 
+class WaveformExporter;
+class QPainter;
+class QTableWidgetItem;
+
 
 // two channels for data
 struct WaveformData {
@@ -19,6 +47,20 @@ struct WaveformData {
     QVector<double> channel2;
 };
 
+// the same two channels as ADC codes, what acquisition and the processing
+// ahead of the display work on. Codes carry kSampleFractionBits bits below
+// the ADC's least significant bit, so filtered, averaged and high
+// resolution samples keep the resolution they gained. Code and fraction
+// together take 14 of the 16 bits, the other two are headroom for filter
+// overshoot; a wider converter gets fewer fraction bits (2 at 12 bits).
+constexpr int kAdcBits = 8;
+constexpr int kSampleFractionBits = 14 - kAdcBits;
+
+struct SampleData {
+    QVector<qint16> channel1;
+    QVector<qint16> channel2;
+};
+
 enum TriggerType {
     NoTrigger,
     RisingEdgeHighlighter,
@@ -31,6 +73,19 @@ struct OscilloscopeSettings {
     double triggerLevel;
 };
 
+// Everything drawing a trace reads from the widgets, taken once per frame
+// so the render loops never call into the UI
+struct FrameSettings {
+    bool locking = false;
+    double lockingLevel = 0.0;
+    TriggerType triggerType = NoTrigger;
+    double triggerLevel = 0.0;
+    double zoom = 30.0;
+    int shift = 0;
+    bool sinc = false;
+    bool statsOverlay = false;
+};
+
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
@@ -42,6 +97,8 @@ public:
     void initializeSerialCommunication();
 
 private:
+    friend class Benchmarks; // benchmarks/ drives the hot paths directly
+
     Ui::MainWindow *ui;
     QSerialPort serial;
 
@@ -53,13 +110,27 @@ private:
 //    bool lockingEnabled;
 //    int lockedRisingEdgeIndex = -1;
 
-    OscilloscopeSettings oscSettings; // Oscilloscope settings
+    OscilloscopeSettings oscSettings{NoTrigger, 0.0}; // Oscilloscope settings
     TriggerType currentTriggerType = NoTrigger;
     WaveformData waveformData;
     WaveformData lockedWaveformData;
-    WaveformData currentBuffer;
-    WaveformData sampledData;
+    SampleData currentBuffer;
+    SampleData sampledData;
+    WaveformData displayBuffer; // currentBuffer smoothed and converted for drawing
     bool isSampling = false;
+    SampleSource *sampleSource = nullptr;
+    bool framedStream = false;
+    FrameParser frameParser;
+    FrameParser::Stats lastStreamStats;
+    SampleSource *createSampleSource();
+    void stopSampling();
+    quint32 currentSampleRate() const;
+
+    void onSourceReady();
+
+    // a watch poll paused the serial stream; nothing is spliced across it
+    void onStreamGap();
+    bool waitingForFrame = false; // no whole frame since the last gap yet
 
     double triggerLevel = 0.0;
 
@@ -72,6 +143,120 @@ private:
 
     double zoomLevel = 30.0;
 
+    // derived traces over channel 1 (A) and channel 2 (B)
+    MathChannel mathChannels[2];
+    QVector<double> mathData[2];
+
+    // logConsole output, batched off the hot paths
+    LogSink logSink;
+
+    // port list kept current off the GUI thread, and the board to reconnect to
+    PortWatcher portWatcher;
+    PortEntry connectedPort;
+    bool reconnectPending = false;
+    bool resumeSampling = false;
+    void connectionLost();
+
+    // hex dump of board memory, rows are read as they scroll into view
+    PeekPipeline *peekPipeline;
+    int peekTicket = -1; // the Peek button's read, logged when it comes back
+    MemoryModel *memoryModel;
+    QString memoryDumpPath;
+    QElapsedTimer memoryDumpClock;
+
+    // registers polled in the background, also while sampling
+    RegisterWatch *registerWatch;
+    void updateWatchTable();
+    void drawWatchPlot();
+
+    // live stream for external analysis processes
+    SharedStreamWriter sharedStream;
+
+    // scripted automation, socket I/O runs on remoteThread
+    QThread remoteThread;
+    RemoteServer *remoteServer;
+    RemoteResult handleRemoteCommand(const RemoteCommand &command, const RemoteServer::Done &done);
+    QHash<int, RemoteServer::Done> remotePeeks; // pipeline ticket -> the remote command waiting for it
+    void onRemotePeekRead(int ticket, quint32 address, const QVector<quint32> &values);
+    void failRemotePeeks(int code, const QString &message);
+
+    // mask testing, every triggered channel 1 frame is checked in Sampling()
+    TriggerSlicer maskSlicer;
+    MaskTest maskTest;
+    bool maskLearning = false;
+    bool maskRunning = false;
+    CaptureWriter maskFailWriter;
+    std::vector<qint8> lastMaskFrame;
+    bool lastMaskFrameFailed = false;
+    void configureMaskSlicer(TriggerSlicer &slicer) const;
+    void feedMaskTest(const char *samples, int count);
+    void drawMask();
+
+    // distribution of every channel 1 sample, counted in Sampling()
+    AmplitudeHistogram histogram;
+    void drawHistogram();
+
+    // eye diagram of channel 1, folded in Sampling() while running
+    EyeDiagram eyeDiagram;
+    bool eyeRunning = false;
+    void drawEye();
+
+    // waterfall of channel 1, transformed in Sampling() while running
+    Spectrogram spectrogram;
+    bool spectrogramRunning = false;
+    void drawSpectrogram();
+
+    // high resolution, filter and decimation on the way to the display.
+    // Both channels have a chain, configured alike, so they reach the
+    // display at the same rate and with the same filter delay, and math
+    // combines samples taken at the same time.
+    struct DisplayChain {
+        BoxcarDecimator highRes;
+        FirFilter filter;
+        FirDecimator decimator;
+        QVector<qint16> highResOutput;
+        std::vector<float> input;
+        std::vector<float> filtered;
+        std::vector<float> decimated;
+    };
+    DisplayChain displayChains[2];
+    bool displayFilterEnabled = false;
+    void appendDisplaySamples(const char *samples, int count);
+    void appendChainSamples(DisplayChain &chain, const qint8 *codes, int count, QVector<qint16> &target);
+    void resetDisplayChains();
+    double displaySampleRate() const; // of the samples in the display buffers
+    void drawFilterResponse(const std::vector<float> &taps);
+
+    // averaging, in the acquisition path of channel 1; high resolution is
+    // the first stage of the display chains
+    AcquisitionMode acquisitionMode = AcquisitionMode::Normal;
+    TriggerSlicer averageSlicer;
+    FrameAverager frameAverager;
+
+    // chart recorder view of channel 1, fed in appendDisplaySamples()
+    RollView rollView;
+    QPixmap rollPixmap; // the plot, scrolled and painted into a frame at a time
+    bool rollMode = false;
+    void drawRoll(const FrameSettings &settings);
+
+    // stored channel 1 traces drawn under the live one
+    ReferenceLibrary referenceLibrary;
+    ReferenceLibrary::Difference referenceDifference; // live against the selected one, last frame
+    QVector<QPointF> overlayPoints;
+    std::vector<quint8> referenceFlags;
+    void updateReferenceTable();
+    void drawReferences(QPainter &painter, QSize labelSize, const QVector<double> &data, int liveStart, const FrameSettings &settings);
+
+    // sin(x)/x display of sparse traces
+    SincInterpolator sincInterpolator;
+    QVector<double> interpolatedData;
+
+    // per frame scratch of drawWaveform(): pixel rows and edge flags
+    FrameSettings frameSettings() const;
+    QVector<double> traceRows;
+    std::vector<quint8> lockFlags;
+    std::vector<quint8> edgeFlags;
+
     int shiftValue = 0;
 
     //    void setupOscilloscopeControls();
@@ -79,14 +264,60 @@ private:
 
     bool snapShot = false;
     WaveformData snapShotData;
-    void  analyzeWaveformData();
+    void  analyzeWaveformData(const FrameSettings &settings);
     void  onDataSliderInit();
     //int timerId;
     void smoothing();
     double calculateWaveformSmoothness();
-    void smoothWaveformData(double windowSize);
+    // channel1 false leaves channel 1 without a frame, while roll mode owns its plot
+    void smoothWaveformData(double windowSize, bool channel1 = true);
+
+    // last few thousand raw samples, for Autoset
+    QByteArray recentSamples;
+    QElapsedTimer autoTrackClock;
+    bool applyAutoset(bool verbose);
+
+    // recording and export
+    CaptureWriter captureWriter;
+    QString capturePath;
+    QThread exportThread;
+    WaveformExporter *exporter;
+
+    // hot path instrumentation readout
+    QTimer *statsTimer;
+    QString perfOverlayText;
 private slots:
     void onAutoSmoothChanged(int state);
+    void onAutoset();
+    void onMathChanged();
+    void onShareToggled(bool checked);
+    void onRemoteToggled();
+    void onMaskLearn();
+    void onMaskLoad();
+    void onMaskRunToggled(bool checked);
+    void onMaskToleranceChanged();
+    void onMemoryGo();
+    void onMemoryRefresh();
+    void onMemoryDump();
+    void onMemoryPageLoaded();
+    void onWatchAdd();
+    void onWatchRemove();
+    void onWatchRunToggled(bool checked);
+    void onWatchPolled();
+    void onHistogramWindowChanged();
+    void onEyeRunToggled(bool checked);
+    void onEyeConfigChanged();
+    void onSpectrogramRunToggled(bool checked);
+    void onSpectrogramConfigChanged();
+    void onSpectrogramDisplayChanged();
+    void onFilterChanged();
+    void onAcquisitionModeChanged();
+    void onRollModeChanged();
+    void onReferenceStore();
+    void onReferenceRemove();
+    void onReferenceSave();
+    void onReferenceLoad();
+    void onReferenceItemChanged(QTableWidgetItem *item);
     void onBrowseFile();
     QString isConnected();
 
@@ -94,12 +325,13 @@ private slots:
     void highlightFallingEdge();
     void setTriggerLevel();
 
-    void drawWaveform(QLabel* label, const QVector<double>& data);
+    void drawWaveform(QLabel* label, const QVector<double>& data, const FrameSettings &settings);
     void generateWaveformData();
     void onDataSliderChanged();
     void onSnapshot();
 
     void onClear();
+    void onLogFileToggled(bool checked);
     void onPeek(const QString &addressStr, bool debug = true);
     void onPoke(const QString &addressStr, const QString &dataStr, bool isHex, bool debug = true);
     void onVersion();
@@ -111,6 +343,9 @@ private slots:
     void onZoomIn();
 
     void onRefreshCOMPorts();
+    void onPortAdded(const PortEntry &port);
+    void onPortRemoved(const PortEntry &port);
+    void onSerialError(QSerialPort::SerialPortError error);
     void updateWaveforms();
     void onUpdateFirmware();
     void updateStatusLabel(const QString &status);
@@ -119,6 +354,15 @@ private slots:
     void onStartStopSampling();
     void Sampling();
     void initDMA();
+
+    void onRecordToggled(bool checked);
+    void onExport();
+    void onExportProgress(qint64 done, qint64 total);
+    void onExportFinished(bool ok, const QString &message);
+
+    void updateStats();
+    void onDumpStats();
+    void onResetStats();
     //    void updateTimerInterval();
 protected:
     //    void timerEvent(QTimerEvent *event) override;
@@ -0,0 +1,72 @@
+//******** masktest.cpp
+#include "masktest.h"
+#include <algorithm>
+
+void MaskTest::beginLearning(int frameLength) {
+    length = std::max(frameLength, 1);
+    learned = 0;
+    ready = false;
+    referenceMax.assign(length, -128);
+    referenceMin.assign(length, 127);
+    upper.clear();
+    lower.clear();
+    resetCounters();
+}
+
+void MaskTest::learn(const qint8 *frame) {
+    for (int i = 0; i < length; ++i) {
+        referenceMax[i] = std::max(referenceMax[i], frame[i]);
+        referenceMin[i] = std::min(referenceMin[i], frame[i]);
+    }
+    learned++;
+}
+
+bool MaskTest::finishLearning(int tolerance, int horizontalTolerance) {
+    if (learned == 0) {
+        return false;
+    }
+
+    upper.resize(length);
+    lower.resize(length);
+    const int h = std::max(horizontalTolerance, 0);
+
+    // built once per reference, the straightforward window scan is fine
+    for (int i = 0; i < length; ++i) {
+        const int first = std::max(0, i - h);
+        const int last = std::min(length - 1, i + h);
+        int high = -128;
+        int low = 127;
+        for (int j = first; j <= last; ++j) {
+            high = std::max<int>(high, referenceMax[j]);
+            low = std::min<int>(low, referenceMin[j]);
+        }
+        upper[i] = static_cast<qint8>(std::min(high + tolerance, 127));
+        lower[i] = static_cast<qint8>(std::max(low - tolerance, -128));
+    }
+
+    ready = true;
+    resetCounters();
+    return true;
+}
+
+int MaskTest::test(const qint8 *frame) {
+    if (!ready) {
+        return 0;
+    }
+
+    // branch free over int8 lanes, 16 codes per SSE2 compare at -O3;
+    // every frame of the stream goes through here
+    const qint8 *hi = upper.data();
+    const qint8 *lo = lower.data();
+    int violations = 0;
+    for (int i = 0; i < length; ++i) {
+        violations += (frame[i] > hi[i]) | (frame[i] < lo[i]);
+    }
+
+    if (violations) {
+        failed++;
+    } else {
+        passed++;
+    }
+    return violations;
+}
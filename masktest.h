@@ -0,0 +1,47 @@
+//******** masktest.h
+#ifndef MASKTEST_H
+#define MASKTEST_H
+
+#include <QtGlobal>
+#include <vector>
+
+// Pass/fail testing of triggered frames against a tolerance envelope.
+// The envelope is learned from one or more reference frames: the per
+// sample min/max over all of them, widened by horizontalTolerance samples
+// to either side and by tolerance counts up and down. Every frame tested
+// afterwards is compared sample by sample against the envelope.
+class MaskTest {
+public:
+    // starts a new reference, frames passed to learn() are merged into it
+    void beginLearning(int frameLength);
+    void learn(const qint8 *frame);
+    // turns the learned reference into the envelope, false if nothing was learned
+    bool finishLearning(int tolerance, int horizontalTolerance);
+
+    bool isReady() const { return ready; }
+    int frameLength() const { return length; }
+    int learnedFrames() const { return learned; }
+
+    // number of samples outside the envelope, counts the frame as a pass or fail
+    int test(const qint8 *frame);
+
+    void resetCounters() { passed = 0; failed = 0; }
+    quint64 passCount() const { return passed; }
+    quint64 failCount() const { return failed; }
+
+    const std::vector<qint8> &upperEnvelope() const { return upper; }
+    const std::vector<qint8> &lowerEnvelope() const { return lower; }
+
+private:
+    int length = 0;
+    int learned = 0;
+    bool ready = false;
+    std::vector<qint8> referenceMax;
+    std::vector<qint8> referenceMin;
+    std::vector<qint8> upper;
+    std::vector<qint8> lower;
+    quint64 passed = 0;
+    quint64 failed = 0;
+};
+
+#endif // MASKTEST_H
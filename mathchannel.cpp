@@ -0,0 +1,369 @@
+//******** mathchannel.cpp
+#include "mathchannel.h"
+#include <algorithm>
+#include <cmath>
+
+// Recursive descent over
+//   expr    := term (('+' | '-') term)*
+//   term    := unary (('*' | '/') unary)*
+//   unary   := '-' unary | primary
+//   primary := number | A | B | func '(' expr ')' | '(' expr ')'
+//   func    := d | int | abs
+class MathChannel::Parser {
+public:
+    Parser(MathChannel &channel, const QString &text) : channel(channel), text(text) {}
+
+    bool parse(Operand &out, QString *error) {
+        out = expr();
+        skipSpaces();
+        if (failed.isEmpty() && pos < text.size()) {
+            fail("unexpected '" + text.mid(pos, 1) + "'");
+        }
+        if (!failed.isEmpty()) {
+            if (error) {
+                *error = failed + " at position " + QString::number(pos + 1);
+            }
+            return false;
+        }
+        return true;
+    }
+
+private:
+    Operand expr() {
+        Operand lhs = term();
+        while (failed.isEmpty()) {
+            skipSpaces();
+            if (!accept('+') && !accept('-')) {
+                break;
+            }
+            const char op = text[pos - 1].toLatin1();
+            lhs = channel.emitBinary(op, lhs, term());
+        }
+        return lhs;
+    }
+
+    Operand term() {
+        Operand lhs = unary();
+        while (failed.isEmpty()) {
+            skipSpaces();
+            if (!accept('*') && !accept('/')) {
+                break;
+            }
+            const char op = text[pos - 1].toLatin1();
+            skipSpaces();
+            const int divisor = pos;
+            const Operand rhs = unary();
+
+            // a constant zero divisor, folded or not, would make every
+            // sample inf or nan
+            if (op == '/' && failed.isEmpty() && rhs.constant && rhs.value == 0.0) {
+                pos = divisor;
+                fail("division by zero");
+                break;
+            }
+            lhs = channel.emitBinary(op, lhs, rhs);
+        }
+        return lhs;
+    }
+
+    Operand unary() {
+        skipSpaces();
+        if (accept('-')) {
+            return channel.emitUnary(Op::Neg, unary());
+        }
+        return primary();
+    }
+
+    Operand primary() {
+        skipSpaces();
+        if (pos >= text.size()) {
+            fail("unexpected end of expression");
+            return constant(0);
+        }
+
+        if (accept('(')) {
+            Operand inner = expr();
+            expect(')');
+            return inner;
+        }
+
+        if (text[pos].isDigit() || text[pos] == '.') {
+            const int start = pos;
+            while (pos < text.size() && (text[pos].isDigit() || text[pos] == '.')) {
+                pos++;
+            }
+            bool ok;
+            const double value = text.mid(start, pos - start).toDouble(&ok);
+            if (!ok) {
+                fail("bad number");
+            }
+            return constant(value);
+        }
+
+        if (text[pos].isLetter()) {
+            const int start = pos;
+            while (pos < text.size() && text[pos].isLetter()) {
+                pos++;
+            }
+            const QString name = text.mid(start, pos - start).toLower();
+
+            if (name == "a") {
+                channel.usesA = true;
+                return load(Op::LoadA);
+            }
+            if (name == "b") {
+                channel.usesB = true;
+                return load(Op::LoadB);
+            }
+
+            Op op;
+            if (name == "d") {
+                op = Op::Derivative;
+            } else if (name == "int") {
+                op = Op::Integral;
+            } else if (name == "abs") {
+                op = Op::Abs;
+            } else {
+                pos = start;
+                fail("unknown name '" + name + "'");
+                return constant(0);
+            }
+
+            expect('(');
+            Operand argument = expr();
+            expect(')');
+            return channel.emitUnary(op, argument);
+        }
+
+        fail("unexpected '" + text.mid(pos, 1) + "'");
+        return constant(0);
+    }
+
+    Operand constant(double value) {
+        return Operand{true, -1, value};
+    }
+
+    Operand load(Op op) {
+        const int dst = channel.allocate();
+        channel.program.push_back({op, dst, -1, -1, 0.0});
+        return Operand{false, dst, 0.0};
+    }
+
+    void skipSpaces() {
+        while (pos < text.size() && text[pos].isSpace()) {
+            pos++;
+        }
+    }
+
+    bool accept(char c) {
+        skipSpaces();
+        if (pos < text.size() && text[pos] == QLatin1Char(c)) {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c) {
+        if (failed.isEmpty() && !accept(c)) {
+            fail(QString("expected '") + QLatin1Char(c) + "'");
+        }
+    }
+
+    void fail(const QString &message) {
+        if (failed.isEmpty()) {
+            failed = message;
+        }
+    }
+
+    MathChannel &channel;
+    const QString &text;
+    int pos = 0;
+    QString failed;
+};
+
+bool MathChannel::compile(const QString &expression, QString *error) {
+    clear();
+    if (expression.trimmed().isEmpty()) {
+        return false;
+    }
+
+    Operand out;
+    Parser parser(*this, expression);
+    if (!parser.parse(out, error)) {
+        clear();
+        return false;
+    }
+
+    result = materialise(out);
+    source = expression;
+    registers.resize(registerCount);
+    return true;
+}
+
+void MathChannel::clear() {
+    source.clear();
+    program.clear();
+    registers.clear();
+    registerCount = 0;
+    result = -1;
+    usesA = false;
+    usesB = false;
+}
+
+int MathChannel::materialise(Operand x) {
+    if (!x.constant) {
+        return x.reg;
+    }
+    const int dst = allocate();
+    program.push_back({Op::Fill, dst, -1, -1, x.value});
+    return dst;
+}
+
+MathChannel::Operand MathChannel::emitUnary(Op op, Operand x) {
+    if (x.constant) {
+        // fold at compile time, a constant has no slope and integrates per sample
+        switch (op) {
+        case Op::Neg: return Operand{true, -1, -x.value};
+        case Op::Abs: return Operand{true, -1, std::fabs(x.value)};
+        case Op::Derivative: return Operand{true, -1, 0.0};
+        default: break;
+        }
+    }
+
+    const int src = materialise(x);
+    const int dst = allocate();
+    program.push_back({op, dst, src, -1, 0.0});
+    return Operand{false, dst, 0.0};
+}
+
+MathChannel::Operand MathChannel::emitBinary(char op, Operand lhs, Operand rhs) {
+    if (lhs.constant && rhs.constant) {
+        switch (op) {
+        case '+': return Operand{true, -1, lhs.value + rhs.value};
+        case '-': return Operand{true, -1, lhs.value - rhs.value};
+        case '*': return Operand{true, -1, lhs.value * rhs.value};
+        default: return Operand{true, -1, lhs.value / rhs.value};
+        }
+    }
+
+    const int dst = allocate();
+
+    // one side constant: scalar kernels, no constant block needed
+    if (rhs.constant) {
+        switch (op) {
+        case '+': program.push_back({Op::AddK, dst, lhs.reg, -1, rhs.value}); break;
+        case '-': program.push_back({Op::AddK, dst, lhs.reg, -1, -rhs.value}); break;
+        case '*': program.push_back({Op::MulK, dst, lhs.reg, -1, rhs.value}); break;
+        default: program.push_back({Op::MulK, dst, lhs.reg, -1, 1.0 / rhs.value}); break;
+        }
+        return Operand{false, dst, 0.0};
+    }
+    if (lhs.constant) {
+        switch (op) {
+        case '+': program.push_back({Op::AddK, dst, rhs.reg, -1, lhs.value}); break;
+        case '-': program.push_back({Op::RSubK, dst, rhs.reg, -1, lhs.value}); break;
+        case '*': program.push_back({Op::MulK, dst, rhs.reg, -1, lhs.value}); break;
+        default: program.push_back({Op::RDivK, dst, rhs.reg, -1, lhs.value}); break;
+        }
+        return Operand{false, dst, 0.0};
+    }
+
+    Op kernel = op == '+' ? Op::Add : op == '-' ? Op::Sub : op == '*' ? Op::Mul : Op::Div;
+    program.push_back({kernel, dst, lhs.reg, rhs.reg, 0.0});
+    return Operand{false, dst, 0.0};
+}
+
+void MathChannel::evaluate(const QVector<double> &a, const QVector<double> &b, QVector<double> &out) {
+    if (!isValid()) {
+        out.clear();
+        return;
+    }
+
+    qsizetype n = -1;
+    if (usesA) {
+        n = a.size();
+    }
+    if (usesB) {
+        n = n < 0 ? b.size() : std::min(n, b.size());
+    }
+    if (n < 0) {
+        n = a.size(); // constant expression, follow channel 1
+    }
+    if (n == 0) {
+        out.clear();
+        return;
+    }
+
+    for (std::vector<double> &reg : registers) {
+        reg.resize(n);
+    }
+
+    // one pass per instruction, each a branch free loop over the block
+    for (const Instruction &in : program) {
+        double *y = registers[in.dst].data();
+        const double *x = in.lhs >= 0 ? registers[in.lhs].data() : nullptr;
+        const double *z = in.rhs >= 0 ? registers[in.rhs].data() : nullptr;
+        const double k = in.k;
+
+        switch (in.op) {
+        case Op::LoadA:
+            std::copy(a.constBegin(), a.constBegin() + n, y);
+            break;
+        case Op::LoadB:
+            std::copy(b.constBegin(), b.constBegin() + n, y);
+            break;
+        case Op::Fill:
+            std::fill(y, y + n, k);
+            break;
+        case Op::Add:
+            for (qsizetype i = 0; i < n; ++i) y[i] = x[i] + z[i];
+            break;
+        case Op::Sub:
+            for (qsizetype i = 0; i < n; ++i) y[i] = x[i] - z[i];
+            break;
+        case Op::Mul:
+            for (qsizetype i = 0; i < n; ++i) y[i] = x[i] * z[i];
+            break;
+        case Op::Div:
+            for (qsizetype i = 0; i < n; ++i) y[i] = z[i] != 0.0 ? x[i] / z[i] : 0.0;
+            break;
+        case Op::AddK:
+            for (qsizetype i = 0; i < n; ++i) y[i] = x[i] + k;
+            break;
+        case Op::MulK:
+            for (qsizetype i = 0; i < n; ++i) y[i] = x[i] * k;
+            break;
+        case Op::RSubK:
+            for (qsizetype i = 0; i < n; ++i) y[i] = k - x[i];
+            break;
+        case Op::RDivK:
+            for (qsizetype i = 0; i < n; ++i) y[i] = x[i] != 0.0 ? k / x[i] : 0.0;
+            break;
+        case Op::Neg:
+            for (qsizetype i = 0; i < n; ++i) y[i] = -x[i];
+            break;
+        case Op::Abs:
+            for (qsizetype i = 0; i < n; ++i) y[i] = std::fabs(x[i]);
+            break;
+        case Op::Derivative:
+            // per sample difference, first point repeats the second
+            for (qsizetype i = 1; i < n; ++i) y[i] = x[i] - x[i - 1];
+            y[0] = n > 1 ? y[1] : 0.0;
+            break;
+        case Op::Integral: {
+            // running sum from the start of the frame
+            double sum = 0.0;
+            for (qsizetype i = 0; i < n; ++i) {
+                sum += x[i];
+                y[i] = sum;
+            }
+            break;
+        }
+        }
+    }
+
+    const std::vector<double> &r = registers[result];
+    out.resize(n);
+    std::copy(r.begin(), r.end(), out.begin());
+}
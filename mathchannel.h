@@ -0,0 +1,75 @@
+//******** mathchannel.h
+#ifndef MATHCHANNEL_H
+#define MATHCHANNEL_H
+
+#include <QString>
+#include <QVector>
+#include <vector>
+
+// A derived trace defined by an expression over the two channels, e.g.
+// "A - B", "A * B", "d(A)", "int(A - 3)", "2 * A + 10", "abs(B)".
+// The expression is compiled once into a flat list of block kernels;
+// evaluate() then runs each kernel over the whole frame in one tight loop
+// instead of interpreting the expression per sample.
+class MathChannel {
+public:
+    bool compile(const QString &expression, QString *error);
+    void clear();
+
+    bool isValid() const { return !program.empty(); }
+    QString expression() const { return source; }
+
+    // out is resized to the common length of the channels the expression uses
+    void evaluate(const QVector<double> &a, const QVector<double> &b, QVector<double> &out);
+
+private:
+    enum class Op {
+        LoadA,
+        LoadB,
+        Fill,   // k
+        Add,
+        Sub,
+        Mul,
+        Div,
+        AddK,   // x + k
+        MulK,   // x * k
+        RSubK,  // k - x
+        RDivK,  // k / x
+        Neg,
+        Abs,
+        Derivative,
+        Integral
+    };
+
+    struct Instruction {
+        Op op;
+        int dst;
+        int lhs;
+        int rhs;
+        double k;
+    };
+
+    // operand on the compile stack, either a register or a folded constant
+    struct Operand {
+        bool constant;
+        int reg;
+        double value;
+    };
+
+    class Parser;
+
+    Operand emitUnary(Op op, Operand x);
+    Operand emitBinary(char op, Operand lhs, Operand rhs);
+    int materialise(Operand x);
+    int allocate() { return registerCount++; }
+
+    QString source;
+    std::vector<Instruction> program;
+    int registerCount = 0;
+    int result = -1;
+    bool usesA = false;
+    bool usesB = false;
+    std::vector<std::vector<double>> registers;
+};
+
+#endif // MATHCHANNEL_H
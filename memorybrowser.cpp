@@ -0,0 +1,323 @@
+//******** memorybrowser.cpp
+#include "memorybrowser.h"
+#include <QtEndian>
+
+// --------------------------------------------- PIPELINE
+
+PeekPipeline::PeekPipeline(QSerialPort *serial, QObject *parent) : QObject(parent), serial(serial) {
+    timeout.setSingleShot(true);
+    timeout.setInterval(kTimeoutMs);
+    connect(&timeout, &QTimer::timeout, this, &PeekPipeline::onTimeout);
+    connect(serial, &QIODevice::aboutToClose, this, &PeekPipeline::onClosing);
+}
+
+int PeekPipeline::read(quint32 address, int count) {
+    if (count <= 0) {
+        return -1;
+    }
+    Request request;
+    request.address = address;
+    request.count = count;
+    return queue(request);
+}
+
+int PeekPipeline::read(const QVector<quint32> &addresses) {
+    if (addresses.isEmpty()) {
+        return -1;
+    }
+    Request request;
+    request.address = addresses.first();
+    request.count = addresses.size();
+    request.addresses = addresses;
+    return queue(request);
+}
+
+int PeekPipeline::queue(Request request) {
+    if (requests.isEmpty()) {
+        connect(serial, &QSerialPort::readyRead, this, &PeekPipeline::onReadyRead, Qt::UniqueConnection);
+    }
+    request.ticket = nextTicket++;
+    request.values.reserve(request.count);
+    requests.append(request);
+    pump();
+    return request.ticket;
+}
+
+// top the window up with one write, replies come back in request order
+void PeekPipeline::pump() {
+    QByteArray message;
+    while (inFlight < kWindow && sendIndex < requests.size()) {
+        const Request &request = requests[sendIndex];
+        const quint32 address = request.addresses.isEmpty() ? request.address + static_cast<quint32>(sendOffset) * 4
+                                                            : request.addresses[sendOffset];
+        message.append('R');
+        message.append(static_cast<char>((address >> 24) & 0xFF));
+        message.append(static_cast<char>((address >> 16) & 0xFF));
+        message.append(static_cast<char>((address >> 8) & 0xFF));
+        message.append(static_cast<char>(address & 0xFF));
+        inFlight++;
+        if (++sendOffset == request.count) {
+            sendIndex++;
+            sendOffset = 0;
+        }
+    }
+    if (!message.isEmpty()) {
+        serial->write(message);
+        timeout.start();
+    }
+}
+
+void PeekPipeline::consume(const QByteArray &data) {
+    pending.append(data);
+
+    // only words that were asked for, anything past them is not a reply
+    QList<Request> done;
+    int offset = 0;
+    while (pending.size() - offset >= 4 && inFlight > 0 && !requests.isEmpty()) {
+        Request &front = requests.first();
+        front.values.append(qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(pending.constData() + offset)));
+        offset += 4;
+        inFlight--;
+
+        if (front.values.size() == front.count) {
+            done.append(requests.takeFirst());
+            sendIndex--;
+        }
+    }
+    pending.remove(0, offset);
+
+    // after the bookkeeping, a receiver may queue or cancel reads
+    for (const Request &request : done) {
+        emit wordsRead(request.ticket, request.address, request.values);
+    }
+}
+
+void PeekPipeline::onReadyRead() {
+    // replies to cancelled reads come first, exactly those bytes are skipped
+    if (stale > 0) {
+        stale -= serial->read(stale).size();
+        if (stale > 0) {
+            timeout.start();
+            return;
+        }
+    }
+    if (requests.isEmpty()) {
+        finish();
+        return;
+    }
+
+    consume(serial->readAll());
+    if (requests.isEmpty()) {
+        if (stale == 0) {
+            finish();
+        }
+        return;
+    }
+    pump();
+    timeout.start();
+}
+
+void PeekPipeline::onTimeout() {
+    if (requests.isEmpty()) {
+        finish(); // the cancelled reads were never answered, stop waiting for them
+        return;
+    }
+    const quint32 address = requests.first().address;
+    requests.clear();
+    finish();
+    emit failed(QString("Peek timed out reading 0x%1").arg(address, 8, 16, QChar('0')).toUpper());
+    emit cancelled();
+}
+
+void PeekPipeline::cancel() {
+    const bool dropped = !requests.isEmpty();
+
+    // whatever was sent is still answered; the bytes are counted here and
+    // onReadyRead takes them off the port ahead of the next reader
+    if (serial->isOpen()) {
+        stale += inFlight * 4 - pending.size();
+    }
+    requests.clear();
+    sendIndex = 0;
+    sendOffset = 0;
+    inFlight = 0;
+    pending.clear();
+    if (stale > 0) {
+        connect(serial, &QSerialPort::readyRead, this, &PeekPipeline::onReadyRead, Qt::UniqueConnection);
+        timeout.start();
+    } else {
+        finish();
+    }
+    if (dropped) {
+        emit cancelled();
+    }
+}
+
+void PeekPipeline::drain() {
+    cancel();
+    if (!requests.isEmpty()) {
+        return; // a receiver of cancelled() queued new reads, they own the port
+    }
+    qint64 left = stale;
+    finish(); // onReadyRead is out of the way from here
+    while (left > 0 && (serial->bytesAvailable() > 0 || serial->waitForReadyRead(kTimeoutMs))) {
+        left -= serial->read(left).size();
+    }
+}
+
+void PeekPipeline::onClosing() {
+    // nothing more arrives on a closed port
+    requests.clear();
+    finish();
+}
+
+void PeekPipeline::finish() {
+    disconnect(serial, &QSerialPort::readyRead, this, &PeekPipeline::onReadyRead);
+    timeout.stop();
+    sendIndex = 0;
+    sendOffset = 0;
+    inFlight = 0;
+    stale = 0;
+    pending.clear();
+}
+
+// --------------------------------------------- MODEL
+
+MemoryModel::MemoryModel(PeekPipeline *pipeline, QObject *parent) : QAbstractTableModel(parent), pipeline(pipeline) {
+    connect(pipeline, &PeekPipeline::wordsRead, this, &MemoryModel::onWordsRead);
+    connect(pipeline, &PeekPipeline::failed, this, &MemoryModel::onFailed);
+    connect(pipeline, &PeekPipeline::cancelled, this, &MemoryModel::onFailed);
+}
+
+void MemoryModel::setRange(quint32 base, quint32 size) {
+    beginResetModel();
+    rangeBase = base & ~static_cast<quint32>(kBytesPerRow - 1);
+    rangeSize = (size + kBytesPerRow - 1) & ~static_cast<quint32>(kBytesPerRow - 1);
+    pages.clear();
+    requested.clear();
+    endResetModel();
+}
+
+void MemoryModel::refresh() {
+    beginResetModel();
+    pages.clear();
+    requested.clear();
+    endResetModel();
+}
+
+void MemoryModel::fetchAll() {
+    const int count = pageCount();
+    for (int page = 0; page < count; ++page) {
+        requestPage(page);
+    }
+}
+
+void MemoryModel::requestPage(quint32 page) const {
+    if (pages.contains(page) || requested.contains(page)) {
+        return;
+    }
+    if (readAllowed && !readAllowed()) {
+        return;
+    }
+    const quint32 offset = page * kPageBytes;
+    const quint32 bytes = qMin<quint32>(kPageBytes, rangeSize - offset);
+    requested.insert(page, pipeline->read(rangeBase + offset, static_cast<int>(bytes / 4)));
+}
+
+void MemoryModel::onWordsRead(int ticket, quint32 address, const QVector<quint32> &values) {
+    if (address < rangeBase || address - rangeBase >= rangeSize) {
+        return; // other readers, or a range that has been replaced since
+    }
+    const quint32 page = (address - rangeBase) / kPageBytes;
+    if (requested.value(page, -1) != ticket) {
+        return;
+    }
+    requested.remove(page);
+    pages.insert(page, values);
+
+    const int firstRow = static_cast<int>(page * (kPageBytes / kBytesPerRow));
+    const int lastRow = qMin(rowCount() - 1, firstRow + kPageBytes / kBytesPerRow - 1);
+    emit dataChanged(index(firstRow, 0), index(lastRow, columnCount() - 1));
+    emit pageLoaded();
+}
+
+void MemoryModel::onFailed() {
+    // not cached, so the rows are asked for again when next shown
+    requested.clear();
+}
+
+QByteArray MemoryModel::bytes() const {
+    QByteArray data(static_cast<int>(rangeSize), '\0');
+    uchar *out = reinterpret_cast<uchar*>(data.data());
+    for (auto it = pages.constBegin(); it != pages.constEnd(); ++it) {
+        const QVector<quint32> &words = it.value();
+        for (int i = 0; i < words.size(); ++i) {
+            qToBigEndian<quint32>(words[i], out + it.key() * kPageBytes + i * 4);
+        }
+    }
+    return data;
+}
+
+// --------------------------------------------- VIEW
+
+int MemoryModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : static_cast<int>(rangeSize / kBytesPerRow);
+}
+
+// address, four words, ascii
+int MemoryModel::columnCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : 2 + kBytesPerRow / 4;
+}
+
+QVariant MemoryModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid()) {
+        return QVariant();
+    }
+    if (role == Qt::TextAlignmentRole) {
+        return int(Qt::AlignCenter);
+    }
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    const quint32 offset = static_cast<quint32>(index.row()) * kBytesPerRow;
+    if (index.column() == 0) {
+        return QString("%1").arg(rangeBase + offset, 8, 16, QChar('0')).toUpper();
+    }
+
+    const quint32 page = offset / kPageBytes;
+    auto it = pages.constFind(page);
+    if (it == pages.constEnd()) {
+        requestPage(page); // the view only asks for rows it shows
+        return index.column() == columnCount() - 1 ? QString("................") : QString("--------");
+    }
+
+    const int firstWord = static_cast<int>((offset % kPageBytes) / 4);
+    if (index.column() <= kBytesPerRow / 4) {
+        const quint32 word = it.value().value(firstWord + index.column() - 1);
+        return QString("%1").arg(word, 8, 16, QChar('0')).toUpper();
+    }
+
+    QString ascii;
+    for (int w = 0; w < kBytesPerRow / 4; ++w) {
+        const quint32 word = it.value().value(firstWord + w);
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            const char c = static_cast<char>((word >> shift) & 0xFF);
+            ascii += (c >= 0x20 && c < 0x7F) ? QChar(c) : QChar('.');
+        }
+    }
+    return ascii;
+}
+
+QVariant MemoryModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    if (section == 0) {
+        return QString("Address");
+    }
+    if (section == columnCount() - 1) {
+        return QString("ASCII");
+    }
+    return QString("+%1").arg((section - 1) * 4, 0, 16).toUpper();
+}
@@ -0,0 +1,130 @@
+//******** memorybrowser.h
+#ifndef MEMORYBROWSER_H
+#define MEMORYBROWSER_H
+
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSerialPort>
+#include <QTimer>
+#include <QVector>
+#include <functional>
+
+// Asynchronous, pipelined Peek. Reads are queued as address ranges and
+// streamed to the board as 'R' requests with up to kWindow of them in
+// flight, so a long read runs at wire speed instead of one round trip
+// per word. Replies are matched up by order as readyRead delivers them;
+// nothing here ever waits on the serial port, cancel() included: the
+// replies to cancelled reads are counted and skipped as they arrive, so
+// none of them reach the next reader or line up with a later request.
+class PeekPipeline : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int kWindow = 64;
+    static constexpr int kTimeoutMs = 1000;
+
+    explicit PeekPipeline(QSerialPort *serial, QObject *parent = nullptr);
+
+    // queues count words starting at address, the returned ticket comes
+    // back with the values
+    int read(quint32 address, int count);
+    // one word from each address, in order; wordsRead reports the first
+    int read(const QVector<quint32> &addresses);
+    // drops everything queued; the replies still on the way are taken off
+    // the port as they come, before anyone else reading it sees them
+    void cancel();
+    // cancel() that waits for those replies and skips them before it
+    // returns, for a blocking command that reads the port itself next
+    void drain();
+
+    bool isBusy() const { return !requests.isEmpty(); }
+
+signals:
+    void wordsRead(int ticket, quint32 address, const QVector<quint32> &values);
+    void failed(const QString &message);
+    // queued reads were dropped by cancel(), they will not be answered
+    void cancelled();
+
+private slots:
+    void onReadyRead();
+    void onTimeout();
+    void onClosing();
+
+private:
+    struct Request {
+        int ticket;
+        quint32 address;
+        int count;
+        QVector<quint32> addresses; // a list rather than a range when not empty
+        QVector<quint32> values;
+    };
+
+    int queue(Request request);
+
+    void pump();
+    void consume(const QByteArray &data);
+    void finish();
+
+    QSerialPort *serial;
+    QList<Request> requests;
+    int sendIndex = 0;  // request holding the next word to send
+    int sendOffset = 0; // word within it
+    int inFlight = 0;
+    qint64 stale = 0;   // reply bytes of cancelled reads still to skip
+    int nextTicket = 0;
+    QByteArray pending; // partial reply
+    QTimer timeout;
+};
+
+// Hex dump of a board memory range, 16 bytes a row. Words are fetched a
+// page at a time, and only when the view asks for a row that is not
+// cached yet, so scrolling through a large range only reads what is seen.
+class MemoryModel : public QAbstractTableModel {
+    Q_OBJECT
+
+public:
+    static constexpr int kBytesPerRow = 16;
+    static constexpr int kPageBytes = 256;
+
+    explicit MemoryModel(PeekPipeline *pipeline, QObject *parent = nullptr);
+
+    // rows are only fetched while this says the port is free
+    void setReadAllowed(std::function<bool()> allowed) { readAllowed = std::move(allowed); }
+
+    void setRange(quint32 base, quint32 size);
+    quint32 base() const { return rangeBase; }
+    quint32 size() const { return rangeSize; }
+
+    // forgets the cache, visible rows are read again
+    void refresh();
+    // queues every page not cached yet
+    void fetchAll();
+    int loadedPages() const { return pages.size(); }
+    int pageCount() const { return static_cast<int>((rangeSize + kPageBytes - 1) / kPageBytes); }
+    // the whole range as the board stores it, big endian words
+    QByteArray bytes() const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+signals:
+    void pageLoaded();
+
+private:
+    void requestPage(quint32 page) const;
+    void onWordsRead(int ticket, quint32 address, const QVector<quint32> &values);
+    void onFailed();
+
+    PeekPipeline *pipeline;
+    std::function<bool()> readAllowed;
+    quint32 rangeBase = 0;
+    quint32 rangeSize = 0;
+    QHash<quint32, QVector<quint32>> pages; // page index -> words
+    mutable QHash<quint32, int> requested;  // page -> ticket, data() is const but fetches on demand
+};
+
+#endif // MEMORYBROWSER_H
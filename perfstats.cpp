@@ -0,0 +1,158 @@
+//******** perfstats.cpp
+#include "perfstats.h"
+#include <QFile>
+#include <QTextStream>
+#include <QDateTime>
+#include <QtAlgorithms>
+
+PerfStats &PerfStats::instance() {
+    static PerfStats stats;
+    return stats;
+}
+
+const char *PerfStats::stageName(PerfStage stage) {
+    switch (stage) {
+    case PerfStage::SerialRead: return "read";
+    case PerfStage::Smooth: return "smooth";
+    case PerfStage::Analyze: return "analyze";
+    case PerfStage::Draw: return "draw";
+    case PerfStage::Frame: return "frame";
+    default: return "?";
+    }
+}
+
+int PerfStats::bucketFor(qint64 nanoseconds) {
+    if (nanoseconds < kSubBuckets) {
+        return nanoseconds < 0 ? 0 : static_cast<int>(nanoseconds);
+    }
+    const int msb = 63 - qCountLeadingZeroBits(static_cast<quint64>(nanoseconds));
+    const int sub = static_cast<int>(nanoseconds >> (msb - 3)) & (kSubBuckets - 1);
+    return std::min((msb - 2) * kSubBuckets + sub, kBuckets - 1);
+}
+
+qint64 PerfStats::bucketValue(int bucket) {
+    if (bucket < kSubBuckets) {
+        return bucket;
+    }
+    const int msb = bucket / kSubBuckets + 2;
+    const int sub = bucket % kSubBuckets;
+    const qint64 width = qint64(1) << (msb - 3);
+    return (kSubBuckets + sub) * width + width / 2;
+}
+
+void PerfStats::record(PerfStage stage, qint64 nanoseconds) {
+    Histogram &h = histograms[static_cast<int>(stage)];
+    h.buckets[bucketFor(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    h.count.fetch_add(1, std::memory_order_relaxed);
+
+    qint64 previous = h.max.load(std::memory_order_relaxed);
+    while (nanoseconds > previous
+           && !h.max.compare_exchange_weak(previous, nanoseconds, std::memory_order_relaxed)) {
+    }
+}
+
+PerfStats::Summary PerfStats::summary(PerfStage stage) const {
+    const Histogram &h = histograms[static_cast<int>(stage)];
+
+    quint32 counts[kBuckets];
+    quint64 total = 0;
+    for (int i = 0; i < kBuckets; ++i) {
+        counts[i] = h.buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    Summary result = {total, 0, 0, h.max.load(std::memory_order_relaxed)};
+    if (total == 0) {
+        return result;
+    }
+
+    const quint64 rank50 = (total + 1) / 2;
+    const quint64 rank99 = total - total / 100;
+    quint64 seen = 0;
+    for (int i = 0; i < kBuckets; ++i) {
+        seen += counts[i];
+        if (result.p50 == 0 && seen >= rank50) {
+            result.p50 = bucketValue(i);
+        }
+        if (seen >= rank99) {
+            result.p99 = bucketValue(i);
+            break;
+        }
+    }
+    return result;
+}
+
+void PerfStats::updateRates() {
+    const quint64 bytes = bytes_.load(std::memory_order_relaxed);
+    const quint64 frames = frames_.load(std::memory_order_relaxed);
+
+    if (rateClock.isValid()) {
+        const double seconds = rateClock.nsecsElapsed() * 1e-9;
+        if (seconds > 0) {
+            bytesRate = (bytes - lastBytes) / seconds;
+            framesRate = (frames - lastFrames) / seconds;
+        }
+    }
+
+    rateClock.start();
+    lastBytes = bytes;
+    lastFrames = frames;
+}
+
+QString PerfStats::report() const {
+    QString text = QString("%1 B/s  %2 fps").arg(bytesRate, 0, 'f', 0).arg(framesRate, 0, 'f', 1);
+    for (int s = 0; s < static_cast<int>(PerfStage::Count); ++s) {
+        Summary sum = summary(static_cast<PerfStage>(s));
+        text += QString("\n%1  p50 %2 us  p99 %3 us  max %4 us")
+                    .arg(QString::fromLatin1(stageName(static_cast<PerfStage>(s))), -8)
+                    .arg(sum.p50 / 1000.0, 0, 'f', 1)
+                    .arg(sum.p99 / 1000.0, 0, 'f', 1)
+                    .arg(sum.max / 1000.0, 0, 'f', 1);
+    }
+    return text;
+}
+
+bool PerfStats::dump(const QString &path) const {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        return false;
+    }
+
+    QTextStream out(&file);
+    out << "# " << QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss") << "\n";
+    out << "bytes_per_s," << bytesRate << "\n";
+    out << "frames_per_s," << framesRate << "\n";
+    out << "stage,count,p50_ns,p99_ns,max_ns\n";
+    for (int s = 0; s < static_cast<int>(PerfStage::Count); ++s) {
+        Summary sum = summary(static_cast<PerfStage>(s));
+        out << stageName(static_cast<PerfStage>(s)) << ',' << sum.count << ',' << sum.p50 << ',' << sum.p99 << ',' << sum.max << "\n";
+    }
+
+    // full histograms so the distribution can be plotted later
+    out << "stage,bucket_ns,count\n";
+    for (int s = 0; s < static_cast<int>(PerfStage::Count); ++s) {
+        const Histogram &h = histograms[s];
+        for (int i = 0; i < kBuckets; ++i) {
+            quint32 count = h.buckets[i].load(std::memory_order_relaxed);
+            if (count > 0) {
+                out << stageName(static_cast<PerfStage>(s)) << ',' << bucketValue(i) << ',' << count << "\n";
+            }
+        }
+    }
+    return true;
+}
+
+void PerfStats::reset() {
+    for (Histogram &h : histograms) {
+        for (auto &bucket : h.buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        h.count.store(0, std::memory_order_relaxed);
+        h.max.store(0, std::memory_order_relaxed);
+    }
+    bytes_.store(0, std::memory_order_relaxed);
+    frames_.store(0, std::memory_order_relaxed);
+    lastBytes = 0;
+    lastFrames = 0;
+    rateClock.invalidate();
+}
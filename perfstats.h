@@ -0,0 +1,99 @@
+//******** perfstats.h
+#ifndef PERFSTATS_H
+#define PERFSTATS_H
+
+#include <QString>
+#include <QElapsedTimer>
+#include <atomic>
+
+// Hot path stages timed once per call
+enum class PerfStage {
+    SerialRead,
+    Smooth,
+    Analyze,
+    Draw,
+    Frame,
+    Count
+};
+
+// Process wide latency histograms and throughput counters. Recording is a
+// couple of relaxed atomic increments so any thread can call it; reading
+// the summaries is meant for the GUI thread.
+class PerfStats {
+public:
+    struct Summary {
+        quint64 count;
+        qint64 p50;
+        qint64 p99;
+        qint64 max;
+    };
+
+    static PerfStats &instance();
+
+    void record(PerfStage stage, qint64 nanoseconds);
+    void addBytes(qint64 bytes) { bytes_.fetch_add(static_cast<quint64>(bytes), std::memory_order_relaxed); }
+    void addFrame() { frames_.fetch_add(1, std::memory_order_relaxed); }
+
+    Summary summary(PerfStage stage) const;
+    // rates since the previous call, call at a steady pace from one thread
+    void updateRates();
+    double bytesPerSecond() const { return bytesRate; }
+    double framesPerSecond() const { return framesRate; }
+
+    QString report() const;
+    bool dump(const QString &path) const;
+    void reset();
+
+    static const char *stageName(PerfStage stage);
+
+private:
+    PerfStats() = default;
+
+    // log linear buckets, 8 per power of two, covers up to ~2^40 ns
+    static constexpr int kSubBuckets = 8;
+    static constexpr int kBuckets = 40 * kSubBuckets;
+    static int bucketFor(qint64 nanoseconds);
+    static qint64 bucketValue(int bucket);
+
+    struct Histogram {
+        std::atomic<quint32> buckets[kBuckets] = {};
+        std::atomic<quint64> count{0};
+        std::atomic<qint64> max{0};
+    };
+
+    Histogram histograms[static_cast<int>(PerfStage::Count)];
+    std::atomic<quint64> bytes_{0};
+    std::atomic<quint64> frames_{0};
+
+    QElapsedTimer rateClock;
+    quint64 lastBytes = 0;
+    quint64 lastFrames = 0;
+    double bytesRate = 0.0;
+    double framesRate = 0.0;
+};
+
+// Times the enclosing scope into one stage
+class PerfScope {
+public:
+    explicit PerfScope(PerfStage stage) : stage(stage) { timer.start(); }
+    ~PerfScope() { PerfStats::instance().record(stage, timer.nsecsElapsed()); }
+
+private:
+    PerfStage stage;
+    QElapsedTimer timer;
+};
+
+// Compiled out entirely unless RICHARDUINO_PERF is defined in the .pro
+#ifdef RICHARDUINO_PERF
+#define PERF_CONCAT_(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_(a, b)
+#define PERF_SCOPE(stage) PerfScope PERF_CONCAT(perfScope, __LINE__)(stage)
+#define PERF_ADD_BYTES(n) PerfStats::instance().addBytes(n)
+#define PERF_ADD_FRAME() PerfStats::instance().addFrame()
+#else
+#define PERF_SCOPE(stage) ((void)0)
+#define PERF_ADD_BYTES(n) ((void)0)
+#define PERF_ADD_FRAME() ((void)0)
+#endif
+
+#endif // PERFSTATS_H
@@ -0,0 +1,92 @@
+//******** portwatcher.cpp
+#include "portwatcher.h"
+#include <QSerialPortInfo>
+#include <QtConcurrent/QtConcurrentRun>
+
+// device nodes appear in bursts while a board enumerates, scan once it settles
+static constexpr int kSettleMs = 300;
+
+// where there is no /dev to watch
+static constexpr int kPollMs = 2000;
+
+// runs on the thread pool, touches nothing but its own locals
+static QList<PortEntry> scanPorts() {
+    QList<PortEntry> found;
+    const QList<QSerialPortInfo> ports = QSerialPortInfo::availablePorts();
+    for (const QSerialPortInfo &port : ports) {
+        // Bluetooth serial links are never the board
+        if (port.description().contains("Standard Serial over Bluetooth link", Qt::CaseInsensitive)) {
+            continue;
+        }
+        PortEntry entry;
+        entry.name = port.portName();
+        entry.description = port.description();
+        entry.serialNumber = port.serialNumber();
+        entry.vendorId = port.hasVendorIdentifier() ? port.vendorIdentifier() : 0;
+        entry.productId = port.hasProductIdentifier() ? port.productIdentifier() : 0;
+        found.append(entry);
+    }
+    return found;
+}
+
+PortWatcher::PortWatcher(QObject *parent) : QObject(parent) {
+    settleTimer.setSingleShot(true);
+    settleTimer.setInterval(kSettleMs);
+    connect(&settleTimer, &QTimer::timeout, this, &PortWatcher::rescan);
+    connect(&scan, &QFutureWatcher<QList<PortEntry>>::finished, this, &PortWatcher::onScanFinished);
+}
+
+void PortWatcher::start() {
+    bool watching = false;
+#ifdef Q_OS_UNIX
+    watching = devWatcher.addPath("/dev");
+    if (watching) {
+        connect(&devWatcher, &QFileSystemWatcher::directoryChanged, &settleTimer, qOverload<>(&QTimer::start));
+    }
+#endif
+    if (!watching) {
+        connect(&pollTimer, &QTimer::timeout, this, &PortWatcher::rescan);
+        pollTimer.start(kPollMs);
+    }
+    rescan();
+}
+
+void PortWatcher::rescan() {
+    if (scan.isRunning()) {
+        scanQueued = true;
+        return;
+    }
+    scan.setFuture(QtConcurrent::run(scanPorts));
+}
+
+void PortWatcher::onScanFinished() {
+    const QList<PortEntry> found = scan.result();
+
+    auto contains = [](const QList<PortEntry> &list, const PortEntry &entry) {
+        for (const PortEntry &e : list) {
+            if (e.name == entry.name) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // removals first so a renamed board is reported gone before it comes back
+    const QList<PortEntry> previous = known;
+    known = found;
+    for (const PortEntry &entry : previous) {
+        if (!contains(found, entry)) {
+            emit portRemoved(entry);
+        }
+    }
+    for (const PortEntry &entry : found) {
+        if (!contains(previous, entry)) {
+            emit portAdded(entry);
+        }
+    }
+
+    if (scanQueued) {
+        scanQueued = false;
+        rescan();
+    }
+}
@@ -0,0 +1,61 @@
+//******** portwatcher.h
+#ifndef PORTWATCHER_H
+#define PORTWATCHER_H
+
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+struct PortEntry {
+    QString name;
+    QString description;
+    QString serialNumber;
+    quint16 vendorId = 0;
+    quint16 productId = 0;
+
+    // the same physical adapter, even if it comes back under another name
+    bool sameDevice(const PortEntry &other) const {
+        if (!serialNumber.isEmpty() || !other.serialNumber.isEmpty()) {
+            return serialNumber == other.serialNumber && vendorId == other.vendorId && productId == other.productId;
+        }
+        return name == other.name;
+    }
+};
+
+// Keeps the list of serial ports current without blocking the GUI thread.
+// QSerialPortInfo::availablePorts() runs on the thread pool through
+// QtConcurrent, which hands back nothing but the list; the watcher that
+// picks it up lives on the GUI thread, and only the differences to the
+// last scan are reported. Rescans are triggered by
+// changes in /dev (inotify) on Unix and by a slow poll elsewhere.
+class PortWatcher : public QObject {
+    Q_OBJECT
+
+public:
+    explicit PortWatcher(QObject *parent = nullptr);
+
+    void start();
+    // queues a scan; while one is running at most one more is queued
+    void rescan();
+
+    const QList<PortEntry> &ports() const { return known; }
+
+signals:
+    void portAdded(const PortEntry &port);
+    void portRemoved(const PortEntry &port);
+
+private:
+    void onScanFinished();
+
+    QList<PortEntry> known;
+    QFutureWatcher<QList<PortEntry>> scan;
+    bool scanQueued = false;
+    QTimer settleTimer;
+    QTimer pollTimer;
+    QFileSystemWatcher devWatcher;
+};
+
+#endif // PORTWATCHER_H
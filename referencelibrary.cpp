@@ -0,0 +1,198 @@
+//******** referencelibrary.cpp
+#include "referencelibrary.h"
+#include "dspkernels.h"
+#include <QFile>
+#include <QtEndian>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static constexpr quint32 kCompressedFlag = 1;
+
+void ReferenceLibrary::add(const QString &name, const double *samples, int count, quint32 sampleRate) {
+    Reference reference;
+    reference.name = name;
+    reference.sampleRate = sampleRate;
+    reference.samples.resize(count);
+    dsp::convert(samples, count, reinterpret_cast<qint8 *>(reference.samples.data()));
+
+    const int index = indexOf(name);
+    if (index >= 0) {
+        reference.visible = references[index].visible;
+        references[index] = reference;
+    } else {
+        references.append(reference);
+    }
+}
+
+void ReferenceLibrary::removeAt(int index) {
+    if (index >= 0 && index < references.size()) {
+        references.removeAt(index);
+    }
+}
+
+int ReferenceLibrary::indexOf(const QString &name) const {
+    for (int i = 0; i < references.size(); ++i) {
+        if (references[i].name == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void ReferenceLibrary::setVisible(int index, bool visible) {
+    if (index >= 0 && index < references.size()) {
+        references[index].visible = visible;
+    }
+}
+
+QString ReferenceLibrary::nextName() const {
+    for (int n = 1;; ++n) {
+        const QString name = "R" + QString::number(n);
+        if (indexOf(name) < 0) {
+            return name;
+        }
+    }
+}
+
+qint64 ReferenceLibrary::sampleBytes() const {
+    qint64 bytes = 0;
+    for (const Reference &reference : references) {
+        bytes += reference.samples.size();
+    }
+    return bytes;
+}
+
+// --------------------------------------------- FILES
+
+bool ReferenceLibrary::save(const QString &path, bool compress) {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        error = file.errorString();
+        return false;
+    }
+
+    QByteArray out(kReferenceHeaderSize, 0);
+    uchar *header = reinterpret_cast<uchar *>(out.data());
+    memcpy(header, "RREF", 4);
+    qToLittleEndian<quint16>(kReferenceVersion, header + 4);
+    qToLittleEndian<quint16>(static_cast<quint16>(references.size()), header + 6);
+    qToLittleEndian<quint32>(compress ? kCompressedFlag : 0, header + 8);
+
+    for (const Reference &reference : references) {
+        const QByteArray name = reference.name.toUtf8();
+        const QByteArray stored = compress ? qCompress(reference.samples, 9) : reference.samples;
+        uchar field[4];
+        qToLittleEndian<quint16>(static_cast<quint16>(name.size()), field);
+        out.append(reinterpret_cast<const char *>(field), 2);
+        out.append(name);
+        qToLittleEndian<quint32>(reference.sampleRate, field);
+        out.append(reinterpret_cast<const char *>(field), 4);
+        qToLittleEndian<quint32>(static_cast<quint32>(stored.size()), field);
+        out.append(reinterpret_cast<const char *>(field), 4);
+        out.append(stored);
+    }
+
+    if (file.write(out) != out.size()) {
+        error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool ReferenceLibrary::load(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        return false;
+    }
+    const QByteArray in = file.readAll();
+    const uchar *data = reinterpret_cast<const uchar *>(in.constData());
+    const qsizetype size = in.size();
+
+    if (size < kReferenceHeaderSize || memcmp(data, "RREF", 4) != 0) {
+        error = "not a reference library";
+        return false;
+    }
+    if (qFromLittleEndian<quint16>(data + 4) != kReferenceVersion) {
+        error = "unsupported reference library version";
+        return false;
+    }
+    const int count = qFromLittleEndian<quint16>(data + 6);
+    const bool compressed = qFromLittleEndian<quint32>(data + 8) & kCompressedFlag;
+
+    // parsed in full before anything is added, a damaged file adds nothing
+    QVector<Reference> loaded;
+    qsizetype offset = kReferenceHeaderSize;
+    for (int i = 0; i < count; ++i) {
+        if (size - offset < 2) {
+            error = "truncated reference library";
+            return false;
+        }
+        const int nameLength = qFromLittleEndian<quint16>(data + offset);
+        offset += 2;
+        if (size - offset < nameLength + 8) {
+            error = "truncated reference library";
+            return false;
+        }
+        Reference reference;
+        reference.name = QString::fromUtf8(in.constData() + offset, nameLength);
+        offset += nameLength;
+        reference.sampleRate = qFromLittleEndian<quint32>(data + offset);
+        const quint32 storedLength = qFromLittleEndian<quint32>(data + offset + 4);
+        offset += 8;
+        if (size - offset < static_cast<qsizetype>(storedLength)) {
+            error = "truncated reference library";
+            return false;
+        }
+        const QByteArray stored = in.mid(offset, storedLength);
+        offset += storedLength;
+        reference.samples = compressed ? qUncompress(stored) : stored;
+        if (compressed && reference.samples.isEmpty() && !stored.isEmpty()) {
+            error = "corrupt samples in " + reference.name;
+            return false;
+        }
+        loaded.append(reference);
+    }
+
+    for (const Reference &reference : loaded) {
+        const int index = indexOf(reference.name);
+        if (index >= 0) {
+            references[index] = reference;
+        } else {
+            references.append(reference);
+        }
+    }
+    error.clear();
+    return true;
+}
+
+// --------------------------------------------- COMPARE
+
+ReferenceLibrary::Difference ReferenceLibrary::compare(const double *live, int liveCount, int liveStart,
+                                                       const qint8 *reference, int referenceCount, int referenceStart) {
+    Difference difference;
+    liveStart = std::max(liveStart, 0);
+    referenceStart = std::max(referenceStart, 0);
+    const int count = std::min(liveCount - liveStart, referenceCount - referenceStart);
+    if (count <= 0) {
+        return difference;
+    }
+
+    live += liveStart;
+    reference += referenceStart;
+    double sum = 0.0;
+    double squares = 0.0;
+    double peak = 0.0;
+    for (int i = 0; i < count; ++i) {
+        const double d = live[i] - reference[i];
+        sum += d;
+        squares += d * d;
+        peak = std::max(peak, std::abs(d));
+    }
+    difference.count = count;
+    difference.mean = sum / count;
+    difference.rms = std::sqrt(squares / count);
+    difference.peak = peak;
+    return difference;
+}
@@ -0,0 +1,82 @@
+//******** referencelibrary.h
+#ifndef REFERENCELIBRARY_H
+#define REFERENCELIBRARY_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+// Reference library files (*.rref) are a 16 byte little endian header
+// followed by one record per reference.
+//
+//   offset  size  field
+//   0       4     magic "RREF"
+//   4       2     version (1)
+//   6       2     reference count
+//   8       4     flags, bit 0: samples are zlib compressed
+//   12      4     reserved (0)
+//
+// and for each reference
+//
+//   2       name length in bytes, then the name in UTF-8
+//   4       sample rate in Hz
+//   4       stored length in bytes, then the samples: signed 8 bit codes,
+//           or qCompress() of them when the flag is set
+constexpr int kReferenceHeaderSize = 16;
+constexpr quint16 kReferenceVersion = 1;
+
+// Named reference traces to lay over the live one. Samples are kept as
+// signed 8 bit codes in a QByteArray, so a reference costs a byte per
+// sample, and handing one to the overlay or copying the library copies no
+// samples at all: the array is implicitly shared and nothing ever writes
+// to it once stored.
+class ReferenceLibrary {
+public:
+    struct Reference {
+        QString name;
+        QByteArray samples;
+        quint32 sampleRate = 0;
+        bool visible = true;
+
+        const qint8 *data() const { return reinterpret_cast<const qint8 *>(samples.constData()); }
+        int size() const { return static_cast<int>(samples.size()); }
+    };
+
+    // live minus reference over the samples both have, in ADC codes
+    struct Difference {
+        int count = 0;
+        double mean = 0.0;
+        double rms = 0.0;
+        double peak = 0.0; // largest absolute difference
+    };
+
+    // a reference of the same name is replaced, codes are rounded and
+    // saturated to 8 bits
+    void add(const QString &name, const double *samples, int count, quint32 sampleRate);
+    void removeAt(int index);
+    void clear() { references.clear(); }
+
+    int count() const { return references.size(); }
+    const Reference &at(int index) const { return references.at(index); }
+    int indexOf(const QString &name) const;
+    void setVisible(int index, bool visible);
+
+    // the first of R1, R2, ... not taken yet
+    QString nextName() const;
+    qint64 sampleBytes() const;
+
+    bool save(const QString &path, bool compress);
+    // adds the file's references to the library
+    bool load(const QString &path);
+    QString errorString() const { return error; }
+
+    // reference from referenceStart lined up with live from liveStart
+    static Difference compare(const double *live, int liveCount, int liveStart,
+                              const qint8 *reference, int referenceCount, int referenceStart);
+
+private:
+    QVector<Reference> references;
+    QString error;
+};
+
+#endif // REFERENCELIBRARY_H
@@ -0,0 +1,147 @@
+//******** registerwatch.cpp
+#include "registerwatch.h"
+
+// a stream streams at least this many times as long as a poll paused it
+static constexpr int kStreamShare = 3;
+
+RegisterWatch::RegisterWatch(PeekPipeline *pipeline, QObject *parent) : QObject(parent), pipeline(pipeline) {
+    clock.start();
+    connect(&pollTimer, &QTimer::timeout, this, &RegisterWatch::poll);
+    connect(pipeline, &PeekPipeline::wordsRead, this, &RegisterWatch::onWordsRead);
+
+    // dropped reads are not retried, the next poll reads everything again
+    auto abandon = [this]() {
+        if (busy) {
+            ticket = -1;
+            finishPoll();
+        }
+    };
+    connect(pipeline, &PeekPipeline::cancelled, this, abandon);
+    connect(pipeline, &PeekPipeline::failed, this, abandon);
+}
+
+void RegisterWatch::setStream(SerialSampleSource *source) {
+    if (stream) {
+        disconnect(stream, nullptr, this, nullptr);
+        // a poll still waiting for the pause is dropped, the next one reads.
+        // The stream is not resumed: its owner is stopping it, and a GO
+        // poke now would put samples on the line among the replies
+        if (busy && ticket < 0) {
+            busy = false;
+        }
+    }
+    stream = source;
+    streamClock.invalidate();
+    if (source) {
+        connect(source, &SerialSampleSource::paused, this, &RegisterWatch::issueReads);
+    }
+}
+
+bool RegisterWatch::add(quint32 address) {
+    for (const Entry &entry : entries) {
+        if (entry.address == address) {
+            return false;
+        }
+    }
+    Entry entry;
+    entry.address = address;
+    entries.append(entry);
+    return true;
+}
+
+void RegisterWatch::removeAt(int index) {
+    if (index >= 0 && index < entries.size()) {
+        entries.remove(index);
+    }
+}
+
+void RegisterWatch::start() {
+    pollTimer.start();
+    poll();
+}
+
+void RegisterWatch::stop() {
+    pollTimer.stop();
+}
+
+// --------------------------------------------- POLL
+
+void RegisterWatch::poll() {
+    if (busy || entries.isEmpty()) {
+        return;
+    }
+    if (readAllowed && !readAllowed()) {
+        return;
+    }
+    // a slow poll stretches the interval rather than starving the stream
+    if (stream && streamClock.isValid() && streamClock.elapsed() < kStreamShare * pauseMs) {
+        return;
+    }
+    busy = true;
+    pollClock.start();
+
+    if (stream) {
+        stream->pause(); // reads go out from paused()
+        return;
+    }
+    issueReads();
+}
+
+void RegisterWatch::issueReads() {
+    if (!busy || ticket >= 0) {
+        return;
+    }
+    pollTime = static_cast<quint32>(clock.elapsed());
+    // one request for the whole list, its replies come back in this order
+    pollAddresses.clear();
+    for (const Entry &entry : entries) {
+        pollAddresses.append(entry.address);
+    }
+    ticket = pipeline->read(pollAddresses);
+    if (ticket < 0) {
+        finishPoll(); // every register was removed since the poll started
+    }
+}
+
+void RegisterWatch::onWordsRead(int readTicket, quint32, const QVector<quint32> &values) {
+    if (readTicket != ticket) {
+        return;
+    }
+    ticket = -1;
+
+    // entries may have been added or removed while the read was out
+    for (Entry &entry : entries) {
+        const int index = pollAddresses.indexOf(entry.address);
+        if (index < 0 || index >= values.size()) {
+            continue;
+        }
+        const quint32 value = values[index];
+        entry.changedLastPoll = entry.valid && value != entry.value;
+        if (!entry.valid || entry.changedLastPoll) {
+            if (entry.history.size() >= kHistoryLength) {
+                entry.history.remove(0, kHistoryLength / 2);
+            }
+            entry.history.append({pollTime, value});
+        }
+        if (entry.changedLastPoll) {
+            entry.changes++;
+        }
+        entry.value = value;
+        entry.valid = true;
+    }
+    finishPoll();
+}
+
+void RegisterWatch::finishPoll() {
+    busy = false;
+    pollMs = pollClock.elapsed();
+    pauseMs = 0;
+    if (stream) {
+        if (stream->isPaused()) {
+            pauseMs = pollMs;
+        }
+        stream->resume();
+        streamClock.start();
+    }
+    emit polled();
+}
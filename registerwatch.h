@@ -0,0 +1,97 @@
+//******** registerwatch.h
+#ifndef REGISTERWATCH_H
+#define REGISTERWATCH_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+#include <algorithm>
+#include <functional>
+#include "memorybrowser.h"
+#include "samplesource.h"
+
+// Polls a list of board registers on a timer. Every poll is a single
+// PeekPipeline request for the whole list, pipelined on the wire, and
+// only value changes go into each register's history, so a register that
+// sits still costs nothing to keep. While the board is streaming, a poll
+// first pauses the stream at a sample boundary (SerialSampleSource::pause)
+// and restarts it once the replies are in, so register replies never mix
+// with samples.
+class RegisterWatch : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int kHistoryLength = 4096;
+
+    // a poll of a stream costs the drain (kQuietMs, 20 ms) plus the reads,
+    // polls closer than this would leave little stream between the gaps
+    static constexpr int kMinIntervalMs = 100;
+
+    // a value and the poll that first read it, ms since the watch was created
+    struct Change {
+        quint32 time;
+        quint32 value;
+    };
+
+    struct Entry {
+        quint32 address = 0;
+        bool valid = false;
+        quint32 value = 0;
+        int changes = 0;
+        bool changedLastPoll = false;
+        QVector<Change> history;
+    };
+
+    explicit RegisterWatch(PeekPipeline *pipeline, QObject *parent = nullptr);
+
+    // polls only run while this says the port is open
+    void setReadAllowed(std::function<bool()> allowed) { readAllowed = std::move(allowed); }
+    // the serial stream to pause around each poll, nullptr when not streaming;
+    // a poll in progress never resumes the stream it was given before
+    void setStream(SerialSampleSource *source);
+
+    bool add(quint32 address);
+    void removeAt(int index);
+    int count() const { return entries.size(); }
+    const Entry &at(int index) const { return entries[index]; }
+
+    void setInterval(int ms) { pollTimer.setInterval(std::max(ms, kMinIntervalMs)); }
+    void start();
+    void stop();
+    bool isRunning() const { return pollTimer.isActive(); }
+
+    // the time base of the histories
+    qint64 elapsed() const { return clock.elapsed(); }
+    // how long the last poll took, and how long it held the stream
+    qint64 lastPollMs() const { return pollMs; }
+    qint64 lastPauseMs() const { return pauseMs; }
+
+signals:
+    void polled();
+
+private:
+    void poll();
+    void issueReads();
+    void onWordsRead(int readTicket, quint32 address, const QVector<quint32> &values);
+    void finishPoll();
+
+    PeekPipeline *pipeline;
+    std::function<bool()> readAllowed;
+    QPointer<SerialSampleSource> stream;
+    QVector<Entry> entries;
+    QTimer pollTimer;
+    QElapsedTimer clock;
+
+    bool busy = false;
+    int ticket = -1; // the poll's batched read, -1 when none is out
+    QVector<quint32> pollAddresses; // what it reads, in reply order
+    quint32 pollTime = 0;
+    QElapsedTimer pollClock;
+    qint64 pollMs = 0;
+    qint64 pauseMs = 0;
+    QElapsedTimer streamClock; // since the stream was last resumed
+};
+
+#endif // REGISTERWATCH_H
@@ -0,0 +1,268 @@
+//******** remoteserver.cpp
+#include "remoteserver.h"
+#include <QHostAddress>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QMetaObject>
+#include <QPointer>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+// a client that sends this much without a newline is dropped
+static constexpr int kMaxLineLength = 4 * 1024 * 1024;
+
+// SYSTem:ERRor? queue depth per client
+static constexpr int kMaxQueuedErrors = 32;
+
+RemoteServer::RemoteServer(QObject *context, Handler handler, QObject *parent)
+    : QObject(parent), context(context), handler(std::move(handler)) {}
+
+bool RemoteServer::matches(const QByteArray &header, const char *pattern) {
+    const QList<QByteArray> given = (header.startsWith(':') ? header.mid(1) : header).toUpper().split(':');
+    const QList<QByteArray> wanted = QByteArray(pattern).split(':');
+    if (given.size() != wanted.size()) {
+        return false;
+    }
+
+    for (int i = 0; i < given.size(); ++i) {
+        QByteArray shortForm;
+        for (char c : wanted[i]) {
+            if (!(c >= 'a' && c <= 'z')) {
+                shortForm.append(c);
+            }
+        }
+        if (given[i] != shortForm && given[i] != wanted[i].toUpper()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RemoteServer::toUInt(const QByteArray &text, quint32 *value) {
+    bool ok;
+    const QByteArray t = text.trimmed().toUpper();
+    if (t.startsWith("0X") || t.startsWith("#H")) {
+        *value = t.mid(2).toUInt(&ok, 16);
+    } else {
+        *value = t.toUInt(&ok, 10);
+    }
+    return ok;
+}
+
+// --------------------------------------------- CONNECTIONS
+
+void RemoteServer::listen(quint16 tcpPort) {
+    close();
+
+    localServer = new QLocalServer(this);
+    localServer->setSocketOptions(QLocalServer::UserAccessOption);
+    QLocalServer::removeServer(kSocketName); // stale socket from a crashed run
+    if (!localServer->listen(kSocketName)) {
+        emit message("ERROR: remote control cannot listen on " + QString(kSocketName) + ". " + localServer->errorString());
+    } else {
+        connect(localServer, &QLocalServer::newConnection, this, [this]() {
+            while (QLocalSocket *socket = localServer->nextPendingConnection()) {
+                connect(socket, &QLocalSocket::disconnected, this, [this, socket]() { removeClient(socket); });
+                addClient(socket);
+            }
+        });
+        emit message("Remote control listening on " + localServer->fullServerName());
+    }
+
+    if (tcpPort != 0) {
+        // loopback only, this is not meant to be reachable from the network
+        tcpServer = new QTcpServer(this);
+        if (!tcpServer->listen(QHostAddress::LocalHost, tcpPort)) {
+            emit message("ERROR: remote control cannot listen on TCP port " + QString::number(tcpPort) + ". " + tcpServer->errorString());
+        } else {
+            connect(tcpServer, &QTcpServer::newConnection, this, [this]() {
+                while (QTcpSocket *socket = tcpServer->nextPendingConnection()) {
+                    socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+                    connect(socket, &QTcpSocket::disconnected, this, [this, socket]() { removeClient(socket); });
+                    addClient(socket);
+                }
+            });
+            emit message("Remote control listening on 127.0.0.1:" + QString::number(tcpPort));
+        }
+    }
+}
+
+void RemoteServer::close() {
+    const QList<QIODevice *> devices = clients.keys();
+    for (QIODevice *device : devices) {
+        device->close();
+        removeClient(device);
+    }
+    delete localServer;
+    localServer = nullptr;
+    delete tcpServer;
+    tcpServer = nullptr;
+}
+
+void RemoteServer::addClient(QIODevice *device) {
+    clients.insert(device, Client());
+    connect(device, &QIODevice::readyRead, this, [this, device]() { dispatch(device); });
+}
+
+void RemoteServer::removeClient(QIODevice *device) {
+    // a batch still with the handler finds the client gone and is dropped
+    if (clients.remove(device)) {
+        device->deleteLater();
+    }
+}
+
+// --------------------------------------------- COMMANDS
+
+// one client's commands on their way through the handler
+struct RemoteServer::Batch {
+    QPointer<RemoteServer> server;
+    QIODevice *device;
+    QList<RemoteCommand> commands;
+    QList<RemoteResult> results;
+    Handler handler;
+};
+
+void RemoteServer::dispatch(QIODevice *device) {
+    auto it = clients.find(device);
+    if (it == clients.end()) {
+        return;
+    }
+    Client &client = it.value();
+    client.buffer.append(device->readAll());
+    if (client.busy) {
+        return; // picked up when the current batch comes back
+    }
+
+    // every complete line received so far goes over as one batch
+    const int end = client.buffer.lastIndexOf('\n');
+    if (end < 0) {
+        if (client.buffer.size() > kMaxLineLength) {
+            emit message("Remote control: dropped a client sending an overlong line");
+            device->close();
+            removeClient(device);
+        }
+        return;
+    }
+    const QByteArray text = client.buffer.left(end);
+    client.buffer.remove(0, end + 1);
+
+    QList<RemoteCommand> commands;
+    for (const QByteArray &line : text.split('\n')) {
+        for (const QByteArray &unit : line.split(';')) {
+            const QByteArray trimmed = unit.trimmed();
+            if (trimmed.isEmpty()) {
+                continue;
+            }
+
+            RemoteCommand command;
+            const int space = trimmed.indexOf(' ');
+            command.header = space < 0 ? trimmed : trimmed.left(space);
+            if (command.header.endsWith('?')) {
+                command.query = true;
+                command.header.chop(1);
+            }
+            if (space >= 0) {
+                for (const QByteArray &argument : trimmed.mid(space + 1).split(',')) {
+                    command.arguments.append(argument.trimmed());
+                }
+            }
+            commands.append(command);
+        }
+    }
+    if (commands.isEmpty()) {
+        return;
+    }
+
+    client.busy = true;
+    auto batch = std::make_shared<Batch>();
+    batch->server = this;
+    batch->device = device;
+    batch->commands = commands;
+    batch->handler = handler;
+    batch->results.reserve(commands.size());
+    QMetaObject::invokeMethod(context, [batch]() { run(batch); }, Qt::QueuedConnection);
+}
+
+// Runs on the context thread. Commands go to the handler in order; one it
+// answers later stops the batch, and its Done picks the batch up again.
+void RemoteServer::run(const std::shared_ptr<Batch> &batch) {
+    while (batch->results.size() < batch->commands.size()) {
+        const RemoteCommand &command = batch->commands[batch->results.size()];
+        if (isLocal(command)) {
+            batch->results.append(RemoteResult());
+            continue;
+        }
+        const RemoteResult result = batch->handler(command, [batch](const RemoteResult &answer) {
+            batch->results.append(answer);
+            run(batch);
+        });
+        if (result.deferred) {
+            return;
+        }
+        batch->results.append(result);
+    }
+
+    QPointer<RemoteServer> self = batch->server;
+    if (self) {
+        QMetaObject::invokeMethod(self, [self, batch]() {
+            self->finish(batch->device, batch->commands, batch->results);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void RemoteServer::finish(QIODevice *device, const QList<RemoteCommand> &commands, const QList<RemoteResult> &results) {
+    auto it = clients.find(device);
+    if (it == clients.end()) {
+        return;
+    }
+    Client &client = it.value();
+
+    QByteArray out;
+    for (int i = 0; i < commands.size(); ++i) {
+        // local commands run here, in order with the rest
+        const RemoteResult result = isLocal(commands[i]) ? executeLocal(client, commands[i]) : results[i];
+        if (result.errorCode != 0) {
+            if (client.errors.size() >= kMaxQueuedErrors) {
+                continue; // nobody is reading them, keep the oldest
+            }
+            client.errors.append(QByteArray::number(result.errorCode) + ",\"" + result.error.toUtf8() + "\"");
+            continue;
+        }
+        if (!commands[i].query) {
+            continue;
+        }
+        if (result.binary) {
+            const QByteArray length = QByteArray::number(result.reply.size());
+            out.append('#');
+            out.append(QByteArray::number(length.size()));
+            out.append(length);
+        }
+        out.append(result.reply);
+        out.append('\n');
+    }
+    if (!out.isEmpty()) {
+        device->write(out);
+    }
+
+    client.busy = false;
+    if (client.buffer.contains('\n') || device->bytesAvailable() > 0) {
+        dispatch(device);
+    }
+}
+
+bool RemoteServer::isLocal(const RemoteCommand &command) {
+    return matches(command.header, "*IDN") || matches(command.header, "SYSTem:ERRor");
+}
+
+RemoteResult RemoteServer::executeLocal(Client &client, const RemoteCommand &command) {
+    if (matches(command.header, "*IDN") && command.query) {
+        return RemoteResult::text("Richarduino,Host,0,1.0");
+    }
+    if (matches(command.header, "SYSTem:ERRor") && command.query) {
+        if (client.errors.isEmpty()) {
+            return RemoteResult::text("0,\"No error\"");
+        }
+        return RemoteResult::text(client.errors.takeFirst());
+    }
+    return RemoteResult::failure(-113, "Undefined header");
+}
@@ -0,0 +1,99 @@
+//******** remoteserver.h
+#ifndef REMOTESERVER_H
+#define REMOTESERVER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <functional>
+#include <memory>
+
+class QIODevice;
+class QLocalServer;
+class QTcpServer;
+
+// One parsed program message unit, e.g. "MEM:POKE 0xFFFFFFB0,1" gives
+// header "MEM:POKE", arguments {"0xFFFFFFB0", "1"} and query false.
+struct RemoteCommand {
+    QByteArray header;
+    QList<QByteArray> arguments;
+    bool query = false;
+};
+
+struct RemoteResult {
+    QByteArray reply;
+    bool binary = false; // sent as an IEEE 488.2 definite length block
+    int errorCode = 0;   // SCPI error number, 0 when the command succeeded
+    QString error;
+    bool deferred = false; // the handler answers later through its Done
+
+    static RemoteResult text(const QByteArray &reply) { RemoteResult r; r.reply = reply; return r; }
+    static RemoteResult block(const QByteArray &data) { RemoteResult r; r.reply = data; r.binary = true; return r; }
+    static RemoteResult failure(int code, const QString &message) { RemoteResult r; r.errorCode = code; r.error = message; return r; }
+    static RemoteResult later() { RemoteResult r; r.deferred = true; return r; }
+};
+
+// SCPI style command server for scripted automation, on a local socket
+// (named "richarduino", a Unix socket on Linux) and optionally on a
+// localhost TCP port. Commands end with a newline and may be chained
+// with ';'. Queries answer with one line, or a "#<n><length><bytes>"
+// block for waveforms; errors are queued per client for SYSTem:ERRor?.
+//
+// The server and all socket I/O live on their own thread. Commands that
+// touch the board or the scope state are handed to the handler on the
+// context object's thread in batches: everything a client has pipelined
+// so far goes over in one hop and the replies come back in one hop, and
+// neither side ever blocks on the other. A command that has to wait for the
+// board returns RemoteResult::later() and calls its Done once, on the
+// context thread, when the answer is in; the rest of the batch runs after it.
+class RemoteServer : public QObject {
+    Q_OBJECT
+
+public:
+    using Done = std::function<void(const RemoteResult &)>;
+    using Handler = std::function<RemoteResult(const RemoteCommand &, const Done &)>;
+
+    static constexpr const char *kSocketName = "richarduino";
+
+    explicit RemoteServer(QObject *context, Handler handler, QObject *parent = nullptr);
+
+    // SCPI mnemonic match, the upper case part of the pattern is the short
+    // form: "SAMP:STAR", "sample:start" and ":SAMPLE:STAR" all match "SAMPle:STARt"
+    static bool matches(const QByteArray &header, const char *pattern);
+    // decimal, or hex with a 0x or #H prefix
+    static bool toUInt(const QByteArray &text, quint32 *value);
+
+public slots:
+    // tcpPort 0 serves the local socket only
+    void listen(quint16 tcpPort);
+    void close();
+
+signals:
+    void message(const QString &text);
+
+private:
+    struct Client {
+        QByteArray buffer;
+        QList<QByteArray> errors;
+        bool busy = false; // a batch is with the handler
+    };
+
+    void addClient(QIODevice *device);
+    void removeClient(QIODevice *device);
+    void dispatch(QIODevice *device);
+    struct Batch;
+    static void run(const std::shared_ptr<Batch> &batch);
+    void finish(QIODevice *device, const QList<RemoteCommand> &commands, const QList<RemoteResult> &results);
+    static bool isLocal(const RemoteCommand &command);
+    RemoteResult executeLocal(Client &client, const RemoteCommand &command);
+
+    QObject *context;
+    Handler handler;
+    QLocalServer *localServer = nullptr;
+    QTcpServer *tcpServer = nullptr;
+    QHash<QIODevice *, Client> clients;
+};
+
+#endif // REMOTESERVER_H
@@ -0,0 +1,155 @@
+//******** rollview.cpp
+#include "rollview.h"
+#include "dspkernels.h"
+#include <algorithm>
+#include <cmath>
+
+static constexpr QRgb kBackground = 0xffffffff;
+static constexpr QRgb kTrace = 0xff000000;
+static constexpr QRgb kMidline = 0xff008000; // Qt::darkGreen
+static constexpr QRgb kLevel = 0xff000080;   // Qt::darkBlue
+
+bool RollView::configure(QSize size, int samplesPerColumn) {
+    samplesPerColumn = std::max(samplesPerColumn, 1);
+    if (size == canvas.size() && samplesPerColumn == perColumn) {
+        return false;
+    }
+    perColumn = samplesPerColumn;
+    canvas = size.isEmpty() ? QImage() : QImage(size, QImage::Format_RGB32);
+    lows.assign(std::max(size.width(), 0), 0);
+    highs.assign(std::max(size.width(), 0), 0);
+    reset();
+    return true;
+}
+
+void RollView::reset() {
+    newest = -1;
+    stored = 0;
+    pending = 0;
+    openCount = 0;
+    for (int x = 0; x < canvas.width(); ++x) {
+        drawColumn(x, false);
+    }
+}
+
+bool RollView::setScale(double newGain, double newOffset, double newLevel) {
+    if (newGain == gain && newOffset == offset && newLevel == level) {
+        return false;
+    }
+    gain = newGain;
+    offset = newOffset;
+    level = newLevel;
+
+    // the whole history at the new scale, the only full redraw
+    const int width = canvas.width();
+    for (int column = 0; column < width; ++column) {
+        drawColumn(column, (newest - column + width) % width < stored);
+    }
+    pending = 0;
+    return !canvas.isNull();
+}
+
+void RollView::feed(const qint16 *samples, qsizetype count) {
+    const int width = canvas.width();
+    if (width == 0) {
+        return;
+    }
+
+    // whole runs of a column at a time through dsp::minMax
+    qsizetype i = 0;
+    while (i < count) {
+        const qsizetype take = std::min<qsizetype>(perColumn - openCount, count - i);
+        qint16 low;
+        qint16 high;
+        dsp::minMax(samples + i, take, low, high);
+        openLow = openCount == 0 ? low : std::min(openLow, low);
+        openHigh = openCount == 0 ? high : std::max(openHigh, high);
+        openCount += static_cast<int>(take);
+        i += take;
+
+        if (openCount == perColumn) {
+            newest = newest + 1 == width ? 0 : newest + 1;
+            lows[newest] = openLow;
+            highs[newest] = openHigh;
+            stored = std::min(stored + 1, width);
+            pending = std::min(pending + 1, width);
+            openCount = 0;
+        }
+    }
+}
+
+int RollView::render() {
+    const int width = canvas.width();
+    const int columns = std::min(pending, width);
+    if (columns == 0) {
+        return 0;
+    }
+    pending = 0;
+
+    // only the new ones, oldest first, each where it sits in the ring
+    for (int age = columns - 1; age >= 0; --age) {
+        drawColumn((newest - age + width) % width, true);
+    }
+    return columns;
+}
+
+void RollView::paint(QPainter &painter, int first, int count) const {
+    const int width = canvas.width();
+    count = std::min(count, width - first);
+    if (count <= 0) {
+        return;
+    }
+
+    // plot x = 0 is the column after the newest, the ring wraps at most once
+    const int start = (newest + 1 + first) % width;
+    const int head = std::min(count, width - start);
+    painter.drawImage(QPoint(first, 0), canvas, QRect(start, 0, head, canvas.height()));
+    if (head < count) {
+        painter.drawImage(QPoint(first + head, 0), canvas, QRect(0, 0, count - head, canvas.height()));
+    }
+}
+
+int RollView::row(double value) const {
+    // one past either edge is enough to clip against
+    const double y = std::nearbyint(value * gain + offset);
+    return static_cast<int>(std::clamp(y, -1.0, static_cast<double>(canvas.height())));
+}
+
+void RollView::drawColumn(int column, bool filled) {
+    const int width = canvas.width();
+    const int height = canvas.height();
+    const qsizetype stride = canvas.bytesPerLine() / sizeof(QRgb);
+    QRgb *pixel = reinterpret_cast<QRgb *>(canvas.bits()) + column;
+
+    for (int y = 0; y < height; ++y) {
+        pixel[y * stride] = kBackground;
+    }
+    const int mid = row(0.0);
+    if (mid >= 0 && mid < height) {
+        pixel[mid * stride] = kMidline;
+    }
+    const int levelRow = row(level);
+    if (levelRow >= 0 && levelRow < height) {
+        pixel[levelRow * stride] = kLevel;
+    }
+    if (!filled) {
+        return;
+    }
+
+    int top = std::min(row(lows[column]), row(highs[column]));
+    int bottom = std::max(row(lows[column]), row(highs[column]));
+
+    // joined to the column before, when it is still in the history
+    const int oldest = (newest - stored + 1 + width) % width;
+    if (column != oldest) {
+        const int previous = column == 0 ? width - 1 : column - 1;
+        const int previousTop = std::min(row(lows[previous]), row(highs[previous]));
+        const int previousBottom = std::max(row(lows[previous]), row(highs[previous]));
+        top = std::min(top, previousBottom);
+        bottom = std::max(bottom, previousTop);
+    }
+
+    for (int y = std::max(top, 0); y <= std::min(bottom, height - 1); ++y) {
+        pixel[y * stride] = kTrace;
+    }
+}
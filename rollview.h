@@ -0,0 +1,65 @@
+//******** rollview.h
+#ifndef ROLLVIEW_H
+#define ROLLVIEW_H
+
+#include <QImage>
+#include <QPainter>
+#include <QSize>
+#include <QtGlobal>
+#include <vector>
+
+// Chart recorder display. Samples are folded into one min/max pair per
+// pixel column as they arrive; render() rasterizes just the columns
+// finished since the last call. The image is a ring of columns like the
+// pairs, so nothing in it ever moves: paint() draws any range of the plot,
+// oldest column at x = 0, in one or two blits. The caller keeps the plot
+// in a pixmap it scrolls by render()'s count and paints only the new
+// columns into, so a frame costs work in proportion to the new data,
+// however long the window. A scale change redraws the kept pairs without
+// going back to the samples.
+class RollView {
+public:
+    // starts over when size or samplesPerColumn changed, and says so
+    bool configure(QSize size, int samplesPerColumn);
+    void reset();
+
+    QSize size() const { return canvas.size(); }
+    int samplesPerColumn() const { return perColumn; }
+
+    // row = value * gain + offset, level is drawn as a line; true when the
+    // scale changed and the history was redrawn
+    bool setScale(double gain, double offset, double level);
+
+    void feed(const qint16 *samples, qsizetype count);
+
+    // columns drawn, 0 when the image did not change
+    int render();
+    // the plot's columns first to first + count - 1, drawn at their place
+    void paint(QPainter &painter, int first, int count) const;
+
+private:
+    // a column of the ring, background and lines only unless filled
+    void drawColumn(int column, bool filled);
+    int row(double value) const;
+
+    QImage canvas;
+    int perColumn = 1;
+    double gain = 1.0;
+    double offset = 0.0;
+    double level = 0.0;
+
+    // min/max per column and its pixels, rings as wide as the plot, newest
+    // last written
+    std::vector<qint16> lows;
+    std::vector<qint16> highs;
+    int newest = -1;
+    int stored = 0;
+    int pending = 0; // finished, not drawn yet
+
+    // the column still filling
+    qint16 openLow = 0;
+    qint16 openHigh = 0;
+    int openCount = 0;
+};
+
+#endif // ROLLVIEW_H
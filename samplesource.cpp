@@ -0,0 +1,386 @@
+//******** samplesource.cpp
+#include "samplesource.h"
+#include "commands.h"
+#include <QAudioBuffer>
+#include <QAudioDecoder>
+#include <QUrl>
+#include <QtMath>
+#include <cmath>
+#include <cstring>
+
+// sampling control register, writing 1 starts the DMA stream and 0 stops it
+static constexpr uint32_t kGoBitAddress = 0xFFFFFFB0;
+
+// no data for this long after the stream is stopped means the board's
+// transmit path and the USB adapter's buffer are both empty
+static constexpr int kQuietMs = 20;
+
+// paced sources release samples this often
+static constexpr int kTickMs = 10;
+
+// never release more than this much signal time in one tick, if the GUI
+// stalls for longer the missed samples are dropped like a real overrun
+static constexpr double kMaxCatchUpSeconds = 0.1;
+
+// replay time a decoded file is kept ahead, and kept whole below it
+static constexpr double kDecodeAheadSeconds = 4.0;
+
+static constexpr double kSyntheticAmplitude = 100.0;
+static constexpr double kSyntheticNoise = 2.0;
+
+SampleSource::SampleSource(QObject *parent) : QObject(parent) {}
+
+// --------------------------------------------- SERIAL
+
+SerialSampleSource::SerialSampleSource(QSerialPort *serial, QObject *parent)
+    : SampleSource(parent), serial(serial) {
+    quietTimer.setInterval(kQuietMs / 4);
+    connect(&quietTimer, &QTimer::timeout, this, &SerialSampleSource::checkQuiet);
+}
+
+bool SerialSampleSource::start() {
+    if (!serial->isOpen()) {
+        error = "There is no comm port connection";
+        return false;
+    }
+
+    connect(serial, &QSerialPort::readyRead, this, &SampleSource::readyRead);
+
+    // GO BIT
+    Poke poke(serial);
+    poke.execute(kGoBitAddress, 1);
+    return true;
+}
+
+void SerialSampleSource::stop() {
+    quietTimer.stop();
+    disconnect(drainConnection);
+    pauseState = Streaming;
+    disconnect(serial, &QSerialPort::readyRead, this, &SampleSource::readyRead);
+    if (!serial->isOpen()) {
+        return;
+    }
+
+    // GO BIT
+    Poke poke(serial);
+    poke.execute(kGoBitAddress, 0);
+
+    // Read and discard all available data in the serial buffer
+    while (serial->bytesAvailable() > 0) {
+        serial->readAll();
+    }
+}
+
+void SerialSampleSource::pause() {
+    if (pauseState != Streaming || !serial->isOpen()) {
+        return;
+    }
+    pauseState = Draining;
+
+    // GO BIT
+    Poke poke(serial);
+    poke.execute(kGoBitAddress, 0);
+
+    lastData.start();
+    drainConnection = connect(serial, &QSerialPort::readyRead, this, [this]() { lastData.start(); });
+    quietTimer.start();
+}
+
+void SerialSampleSource::checkQuiet() {
+    if (serial->bytesAvailable() > 0 || lastData.elapsed() < kQuietMs) {
+        return;
+    }
+
+    // every sample sent before the stop has been delivered, the port is free
+    quietTimer.stop();
+    disconnect(drainConnection);
+    disconnect(serial, &QSerialPort::readyRead, this, &SampleSource::readyRead);
+    pauseState = Paused;
+    emit paused();
+}
+
+void SerialSampleSource::resume() {
+    if (pauseState == Streaming) {
+        return;
+    }
+    quietTimer.stop();
+    disconnect(drainConnection);
+    pauseState = Streaming;
+    if (!serial->isOpen()) {
+        return;
+    }
+
+    connect(serial, &QSerialPort::readyRead, this, &SampleSource::readyRead, Qt::UniqueConnection);
+
+    // GO BIT
+    Poke poke(serial);
+    poke.execute(kGoBitAddress, 1);
+}
+
+// --------------------------------------------- PACED
+
+PacedSampleSource::PacedSampleSource(QObject *parent) : SampleSource(parent) {
+    timer.setTimerType(Qt::PreciseTimer);
+    connect(&timer, &QTimer::timeout, this, &PacedSampleSource::tick);
+}
+
+bool PacedSampleSource::start() {
+    opening = false;
+    if (!open()) {
+        return false;
+    }
+    if (rate == 0 && !opening) {
+        error = "Sample rate must be greater than zero";
+        return false;
+    }
+
+    released = 0;
+    pending.clear();
+    if (!opening) {
+        begin();
+    }
+    return true;
+}
+
+void PacedSampleSource::formatKnown(quint32 sampleRate) {
+    rate = sampleRate;
+    opening = false;
+    begin();
+    emit ready();
+}
+
+void PacedSampleSource::begin() {
+    clock.start();
+    timer.start(kTickMs);
+}
+
+void PacedSampleSource::stop() {
+    timer.stop();
+    pending.clear();
+}
+
+QByteArray PacedSampleSource::readAll() {
+    QByteArray data;
+    data.swap(pending);
+    return data;
+}
+
+void PacedSampleSource::tick() {
+    const qint64 target = static_cast<qint64>(clock.nsecsElapsed() * 1e-9 * rate);
+    qint64 due = target - released;
+
+    const qint64 maxDue = static_cast<qint64>(kMaxCatchUpSeconds * rate) + 1;
+    if (due > maxDue) {
+        released = target - maxDue;
+        due = maxDue;
+    }
+    if (due <= 0) {
+        return;
+    }
+
+    const qint64 offset = pending.size();
+    pending.resize(offset + due);
+    const qint64 produced = produce(pending.data() + offset, due);
+    pending.resize(offset + produced);
+    released += due;
+
+    if (produced > 0) {
+        emit readyRead();
+    }
+}
+
+// --------------------------------------------- CAPTURE REPLAY
+
+CaptureSampleSource::CaptureSampleSource(const QString &path, QObject *parent)
+    : PacedSampleSource(parent), path(path) {}
+
+bool CaptureSampleSource::open() {
+    if (!capture.open(path)) {
+        error = "cannot open capture " + path + ". " + capture.errorString();
+        return false;
+    }
+    if (capture.sampleCount() == 0) {
+        error = "capture " + path + " is empty";
+        return false;
+    }
+    rate = capture.sampleRate() * capture.channelCount();
+    return true;
+}
+
+qint64 CaptureSampleSource::produce(char *dst, qint64 count) {
+    qint64 produced = 0;
+    while (produced < count) {
+        qint64 n = capture.read(dst + produced, count - produced);
+        if (n == 0) {
+            capture.seek(0); // loop
+            n = capture.read(dst + produced, count - produced);
+            if (n == 0) {
+                break;
+            }
+        }
+        produced += n;
+    }
+    return produced;
+}
+
+// --------------------------------------------- WAV REPLAY
+
+WavSampleSource::WavSampleSource(const QString &path, QObject *parent)
+    : PacedSampleSource(parent), path(path) {}
+
+bool WavSampleSource::open() {
+    // only starts the decoder, nothing waits for the file here; the rate
+    // and formatKnown() come with the first buffer
+    decoder = new QAudioDecoder(this);
+    decoder->setSource(QUrl::fromLocalFile(path));
+    connect(decoder, &QAudioDecoder::bufferReady, this, &WavSampleSource::onBufferReady);
+    connect(decoder, &QAudioDecoder::finished, this, [this]() {
+        decodingDone = true;
+    });
+    connect(decoder, QOverload<QAudioDecoder::Error>::of(&QAudioDecoder::error), this, [this]() {
+        emit failed("cannot decode " + path + ". " + decoder->errorString());
+    });
+
+    decoder->start();
+    if (decoder->error() != QAudioDecoder::NoError) {
+        error = "cannot decode " + path + ". " + decoder->errorString();
+        return false;
+    }
+    opening = true;
+    return true;
+}
+
+qint64 WavSampleSource::window() const {
+    return static_cast<qint64>(kDecodeAheadSeconds * rate);
+}
+
+void WavSampleSource::onBufferReady() {
+    // far enough ahead, the buffer waits in the decoder until produce()
+    // has replayed some of what is decoded
+    if (rate > 0 && decoded.size() - position >= window()) {
+        return;
+    }
+    const QAudioBuffer buffer = decoder->read();
+    if (!buffer.isValid()) {
+        return;
+    }
+    const QAudioFormat format = buffer.format();
+    const int channels = format.channelCount();
+    const qsizetype frames = buffer.frameCount();
+
+    const qsizetype offset = decoded.size();
+    decoded.resize(offset + frames);
+    char *dst = decoded.data() + offset;
+
+    // keep the first channel, reduced to the 8 bits the board would deliver
+    for (qsizetype i = 0; i < frames; ++i) {
+        const qsizetype s = i * channels;
+        int value = 0;
+        switch (format.sampleFormat()) {
+        case QAudioFormat::UInt8:
+            value = buffer.constData<quint8>()[s] - 128;
+            break;
+        case QAudioFormat::Int16:
+            value = buffer.constData<qint16>()[s] >> 8;
+            break;
+        case QAudioFormat::Int32:
+            value = buffer.constData<qint32>()[s] >> 24;
+            break;
+        case QAudioFormat::Float:
+            value = qBound(-128, qRound(buffer.constData<float>()[s] * 127.0f), 127);
+            break;
+        default:
+            break;
+        }
+        dst[i] = static_cast<char>(value);
+    }
+
+    if (opening) {
+        if (format.sampleRate() <= 0) {
+            decoder->stop();
+            emit failed("cannot decode " + path + ". No sample rate");
+            return;
+        }
+        formatKnown(format.sampleRate());
+    }
+}
+
+qint64 WavSampleSource::produce(char *dst, qint64 count) {
+    qint64 produced = 0;
+    while (produced < count && !decoded.isEmpty()) {
+        if (position >= decoded.size()) {
+            if (!decodingDone) {
+                break; // decoder has not caught up yet
+            }
+            if (dropped) {
+                // the start of the file is gone, decode it again
+                decoded.clear();
+                position = 0;
+                dropped = false;
+                decodingDone = false;
+                decoder->stop();
+                decoder->start();
+                break;
+            }
+            position = 0; // loop
+        }
+        const qint64 n = std::min<qint64>(count - produced, decoded.size() - position);
+        memcpy(dst + produced, decoded.constData() + position, n);
+        position += n;
+        produced += n;
+    }
+
+    // a window's worth replayed: let go of it, the file is too long to keep
+    if (position >= window() && !decodingDone) {
+        decoded.remove(0, position);
+        position = 0;
+        dropped = true;
+    }
+
+    // and take the buffer that was held back, if any
+    if (decoder->bufferAvailable()) {
+        onBufferReady();
+    }
+    return produced;
+}
+
+// --------------------------------------------- SYNTHETIC
+
+SyntheticSampleSource::SyntheticSampleSource(Shape shape, quint32 sampleRate, double frequency, QObject *parent)
+    : PacedSampleSource(parent), shape(shape), frequency(frequency), gaussian(0.0, kSyntheticNoise) {
+    rate = sampleRate;
+}
+
+QString SyntheticSampleSource::name() const {
+    static const char *shapes[] = {"sine", "square", "triangle"};
+    return QString("%1 Hz %2 at %3 S/s").arg(frequency).arg(shapes[shape]).arg(rate);
+}
+
+bool SyntheticSampleSource::open() {
+    phase = 0.0;
+    return true;
+}
+
+qint64 SyntheticSampleSource::produce(char *dst, qint64 count) {
+    const double step = frequency / rate;
+    for (qint64 i = 0; i < count; ++i) {
+        double value;
+        switch (shape) {
+        case Square:
+            value = phase < 0.5 ? kSyntheticAmplitude : -kSyntheticAmplitude;
+            break;
+        case Triangle:
+            value = kSyntheticAmplitude * (phase < 0.5 ? 4.0 * phase - 1.0 : 3.0 - 4.0 * phase);
+            break;
+        default:
+            value = kSyntheticAmplitude * qSin(2.0 * M_PI * phase);
+            break;
+        }
+        value += gaussian(generator);
+        dst[i] = static_cast<char>(qBound(-128, qRound(value), 127));
+
+        phase += step;
+        phase -= std::floor(phase);
+    }
+    return count;
+}
@@ -0,0 +1,190 @@
+//******** samplesource.h
+#ifndef SAMPLESOURCE_H
+#define SAMPLESOURCE_H
+
+#include <QObject>
+#include <QSerialPort>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <random>
+#include "capturefile.h"
+
+class QAudioDecoder;
+
+// Anything that produces signed 8 bit samples for the acquisition pipeline.
+// readyRead() is emitted whenever new samples can be taken with readAll().
+// A source whose format is only known some time after start() returns 0
+// from sampleRate() until then and emits ready() once it is; failed() ends
+// a source that cannot go on.
+class SampleSource : public QObject {
+    Q_OBJECT
+
+public:
+    explicit SampleSource(QObject *parent = nullptr);
+
+    virtual bool start() = 0;
+    virtual void stop() = 0;
+    virtual QByteArray readAll() = 0;
+    virtual quint32 sampleRate() const = 0;
+    virtual QString name() const = 0;
+
+    QString errorString() const { return error; }
+
+signals:
+    void readyRead();
+    void ready();
+    void failed(const QString &message);
+
+protected:
+    QString error;
+};
+
+// The board itself, streaming over the already opened serial port.
+class SerialSampleSource : public SampleSource {
+    Q_OBJECT
+
+public:
+    explicit SerialSampleSource(QSerialPort *serial, QObject *parent = nullptr);
+
+    bool start() override;
+    void stop() override;
+    QByteArray readAll() override { return serial->readAll(); }
+    quint32 sampleRate() const override { return kSerialSampleRate; }
+    QString name() const override { return serial->portName(); }
+
+    // Lends the port out between sample blocks. pause() stops the DMA
+    // stream but keeps delivering the samples still on the way; once the
+    // line has been quiet for kQuietMs the source lets go of the port and
+    // emits paused(). resume() takes it back and restarts the stream.
+    void pause();
+    void resume();
+    bool isPaused() const { return pauseState == Paused; }
+
+signals:
+    void paused();
+
+private:
+    enum PauseState { Streaming, Draining, Paused };
+
+    void checkQuiet();
+
+    QSerialPort *serial;
+    PauseState pauseState = Streaming;
+    QElapsedTimer lastData;
+    QMetaObject::Connection drainConnection;
+    QTimer quietTimer;
+};
+
+// Base for the sources that have no hardware clock. A timer releases
+// samples at sampleRate() measured against wall time, so the pipeline sees
+// the same pacing it would get from a device running at that rate.
+class PacedSampleSource : public SampleSource {
+    Q_OBJECT
+
+public:
+    explicit PacedSampleSource(QObject *parent = nullptr);
+
+    bool start() override;
+    void stop() override;
+    QByteArray readAll() override;
+    quint32 sampleRate() const override { return rate; }
+
+protected:
+    // sets rate, or sets opening and calls formatKnown() later
+    virtual bool open() = 0;
+    // fills dst with up to count samples, returns how many were produced
+    virtual qint64 produce(char *dst, qint64 count) = 0;
+    void formatKnown(quint32 sampleRate);
+
+    quint32 rate = 0;
+    bool opening = false;
+
+private slots:
+    void tick();
+
+private:
+    void begin();
+
+    QTimer timer;
+    QElapsedTimer clock;
+    qint64 released = 0;
+    QByteArray pending;
+};
+
+// Replays a recorded *.rcap capture, looping at the end.
+class CaptureSampleSource : public PacedSampleSource {
+    Q_OBJECT
+
+public:
+    explicit CaptureSampleSource(const QString &path, QObject *parent = nullptr);
+    QString name() const override { return path; }
+
+protected:
+    bool open() override;
+    qint64 produce(char *dst, qint64 count) override;
+
+private:
+    QString path;
+    CaptureReader capture;
+};
+
+// Replays the first channel of an audio file decoded by QAudioDecoder,
+// scaled down to 8 bits and looping at the end. open() only starts the
+// decoder, the rate comes with the first buffer. The decoder is kept
+// kDecodeAheadSeconds ahead of the replay: buffers past that are left
+// unread, which holds a pull driven backend back, and what has been
+// replayed is dropped, so a long file never sits in memory. A file shorter
+// than that is kept whole and looped without decoding it again.
+class WavSampleSource : public PacedSampleSource {
+    Q_OBJECT
+
+public:
+    explicit WavSampleSource(const QString &path, QObject *parent = nullptr);
+    QString name() const override { return path; }
+
+protected:
+    bool open() override;
+    qint64 produce(char *dst, qint64 count) override;
+
+private slots:
+    void onBufferReady();
+
+private:
+    qint64 window() const;
+
+    QString path;
+    QAudioDecoder *decoder = nullptr;
+    QByteArray decoded;
+    qint64 position = 0;
+    bool dropped = false; // replayed samples were let go, a loop decodes again
+    bool decodingDone = false;
+};
+
+// Synthetic test signal at an arbitrary sample rate, for driving the
+// pipeline without hardware and above what the serial link can carry.
+class SyntheticSampleSource : public PacedSampleSource {
+    Q_OBJECT
+
+public:
+    enum Shape {
+        Sine,
+        Square,
+        Triangle
+    };
+
+    SyntheticSampleSource(Shape shape, quint32 sampleRate, double frequency, QObject *parent = nullptr);
+    QString name() const override;
+
+protected:
+    bool open() override;
+    qint64 produce(char *dst, qint64 count) override;
+
+private:
+    Shape shape;
+    double frequency;
+    double phase = 0.0;
+    std::mt19937 generator;
+    std::normal_distribution<double> gaussian;
+};
+
+#endif // SAMPLESOURCE_H
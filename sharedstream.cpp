@@ -0,0 +1,137 @@
+//******** sharedstream.cpp
+#include "sharedstream.h"
+#include <cstring>
+#include <new>
+
+#ifndef Q_OS_WIN
+#include <cerrno>
+#endif
+
+SharedStreamWriter::~SharedStreamWriter() {
+    close();
+}
+
+bool SharedStreamWriter::open(quint32 sampleRate, quint16 channelCount, quint32 capacity) {
+    using namespace richarduino;
+
+    close();
+    channelCount = qBound<quint16>(1, channelCount, kStreamMaxChannels);
+    quint32 rounded = 1;
+    while (rounded < capacity) {
+        rounded <<= 1;
+    }
+    mappedSize = sizeof(StreamHeader) + static_cast<size_t>(rounded) * channelCount;
+
+    void *address = nullptr;
+#ifdef Q_OS_WIN
+    mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                 0, static_cast<DWORD>(mappedSize), kStreamName);
+    if (mapping) {
+        address = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, mappedSize);
+    }
+    if (!address) {
+        error = QString("cannot create shared memory %1 (error %2)").arg(kStreamName).arg(GetLastError());
+        if (mapping) {
+            CloseHandle(mapping);
+            mapping = nullptr;
+        }
+        return false;
+    }
+#else
+    // a stale segment from a crashed run may have another size, start fresh
+    shm_unlink(kStreamName);
+    const int fd = shm_open(kStreamName, O_CREAT | O_RDWR, 0644);
+    if (fd < 0 || ftruncate(fd, static_cast<off_t>(mappedSize)) != 0) {
+        error = QString("cannot create shared memory %1: %2").arg(kStreamName, QString::fromLocal8Bit(strerror(errno)));
+        if (fd >= 0) {
+            ::close(fd);
+            shm_unlink(kStreamName);
+        }
+        return false;
+    }
+    address = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        error = QString("cannot map shared memory %1: %2").arg(kStreamName, QString::fromLocal8Bit(strerror(errno)));
+        shm_unlink(kStreamName);
+        return false;
+    }
+#endif
+
+    // fill in everything, the magic last so readers never see half a header
+    std::memset(address, 0, sizeof(StreamHeader));
+    header = new (address) StreamHeader;
+    header->version = kStreamVersion;
+    header->headerSize = sizeof(StreamHeader);
+    header->capacity = rounded;
+    header->channelCount = channelCount;
+    header->sampleFormat = kStreamFormatInt8;
+    header->sampleRate.store(sampleRate, std::memory_order_relaxed);
+    for (StreamCursor &cursor : header->cursor) {
+        cursor.begin.store(0, std::memory_order_relaxed);
+        cursor.end.store(0, std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, kStreamMagic, sizeof(kStreamMagic));
+
+    rings = static_cast<char *>(address) + sizeof(StreamHeader);
+    error.clear();
+    return true;
+}
+
+void SharedStreamWriter::close() {
+    if (!header) {
+        return;
+    }
+
+    // readers that are still attached keep their mapping until they let go,
+    // the flag tells them to open the name again
+    header->closed.store(1, std::memory_order_release);
+#ifdef Q_OS_WIN
+    UnmapViewOfFile(header);
+    CloseHandle(mapping);
+    mapping = nullptr;
+#else
+    munmap(header, mappedSize);
+    shm_unlink(richarduino::kStreamName);
+#endif
+    header = nullptr;
+    rings = nullptr;
+    mappedSize = 0;
+}
+
+void SharedStreamWriter::setSampleRate(quint32 sampleRate) {
+    if (header) {
+        header->sampleRate.store(sampleRate, std::memory_order_relaxed);
+    }
+}
+
+void SharedStreamWriter::write(int channel, const char *samples, qint64 count) {
+    if (!header || channel < 0 || channel >= header->channelCount || count <= 0) {
+        return;
+    }
+
+    richarduino::StreamCursor &cursor = header->cursor[channel];
+    const quint64 capacity = header->capacity;
+    quint64 start = cursor.end.load(std::memory_order_relaxed);
+    const quint64 end = start + count;
+
+    // a chunk longer than the ring only leaves its tail behind
+    if (static_cast<quint64>(count) > capacity) {
+        samples += count - capacity;
+        start = end - capacity;
+        count = static_cast<qint64>(capacity);
+    }
+
+    // claim the region first so readers can tell it is being overwritten
+    cursor.begin.store(end, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    char *ring = rings + channel * capacity;
+    const quint64 offset = start & (capacity - 1);
+    const quint64 first = qMin<quint64>(count, capacity - offset);
+    std::memcpy(ring + offset, samples, first);
+    std::memcpy(ring, samples + first, count - first);
+
+    cursor.end.store(end, std::memory_order_release);
+}
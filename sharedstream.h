@@ -0,0 +1,38 @@
+//******** sharedstream.h
+#ifndef SHAREDSTREAM_H
+#define SHAREDSTREAM_H
+
+#include <QString>
+#include <QtGlobal>
+#include "streamreader/richarduino_stream.h"
+
+// Publishes the live sample stream into a shared memory ring for external
+// analysis tools; the layout is documented in streamreader/richarduino_stream.h,
+// which is also the reader library. Writing is a copy into the ring plus two
+// atomic stores, readers only ever map the segment read only, so nothing a
+// consumer does can stall Sampling().
+class SharedStreamWriter {
+public:
+    ~SharedStreamWriter();
+
+    // capacity is per channel and rounded up to a power of two
+    bool open(quint32 sampleRate, quint16 channelCount = 2, quint32 capacity = 1 << 22);
+    void close();
+
+    void setSampleRate(quint32 sampleRate);
+    void write(int channel, const char *samples, qint64 count);
+
+    bool isOpen() const { return header != nullptr; }
+    QString errorString() const { return error; }
+
+private:
+    richarduino::StreamHeader *header = nullptr;
+    char *rings = nullptr;
+    size_t mappedSize = 0;
+#ifdef Q_OS_WIN
+    void *mapping = nullptr;
+#endif
+    QString error;
+};
+
+#endif // SHAREDSTREAM_H
@@ -0,0 +1,62 @@
+//******** sincinterpolator.cpp
+#include "sincinterpolator.h"
+#include <cmath>
+
+SincInterpolator::SincInterpolator() : taps(kPhases * kTaps) {
+    const double pi = std::acos(-1.0);
+    const int half = kTaps / 2;
+
+    for (int p = 0; p < kPhases; ++p) {
+        const double frac = static_cast<double>(p) / kPhases;
+        double *row = &taps[p * kTaps];
+        double sum = 0.0;
+
+        for (int t = 0; t < kTaps; ++t) {
+            // distance from the output point to input sample n - half + 1 + t
+            const double x = (t - half + 1) - frac;
+            const double sinc = x == 0.0 ? 1.0 : std::sin(pi * x) / (pi * x);
+            // Blackman window over the kernel span
+            const double w = (x + half) / kTaps;
+            const double window = 0.42 - 0.5 * std::cos(2.0 * pi * w) + 0.08 * std::cos(4.0 * pi * w);
+            row[t] = sinc * window;
+            sum += row[t];
+        }
+
+        // unity DC gain for every phase so flat signals stay flat
+        for (int t = 0; t < kTaps; ++t) {
+            row[t] /= sum;
+        }
+    }
+}
+
+void SincInterpolator::resample(const double *data, int size, double start, double step, int outCount, double *out) const {
+    const int half = kTaps / 2;
+
+    for (int i = 0; i < outCount; ++i) {
+        const double position = start + i * step;
+        const int n = static_cast<int>(std::floor(position));
+        const int phase = static_cast<int>((position - n) * kPhases) & (kPhases - 1);
+        const double *row = &taps[phase * kTaps];
+        const int first = n - half + 1;
+
+        double acc[4] = {0.0, 0.0, 0.0, 0.0};
+        if (first >= 0 && first + kTaps <= size) {
+            // fast path, four independent sums the compiler can keep in vector registers
+            const double *x = data + first;
+            for (int t = 0; t < kTaps; t += 4) {
+                acc[0] += row[t] * x[t];
+                acc[1] += row[t + 1] * x[t + 1];
+                acc[2] += row[t + 2] * x[t + 2];
+                acc[3] += row[t + 3] * x[t + 3];
+            }
+        } else {
+            // near the ends, hold the first and last sample
+            for (int t = 0; t < kTaps; ++t) {
+                int index = first + t;
+                index = index < 0 ? 0 : (index >= size ? size - 1 : index);
+                acc[t & 3] += row[t] * data[index];
+            }
+        }
+        out[i] = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+    }
+}
@@ -0,0 +1,29 @@
+//******** sincinterpolator.h
+#ifndef SINCINTERPOLATOR_H
+#define SINCINTERPOLATOR_H
+
+#include <vector>
+
+// Windowed sinc interpolation for displaying signals with only a few
+// samples per period. The kernel is split into kPhases polyphase branches
+// of kTaps taps each, all precomputed, so every output point is a single
+// kTaps long dot product regardless of where it falls between samples.
+class SincInterpolator {
+public:
+    static constexpr int kTaps = 16;
+    static constexpr int kPhases = 256;
+
+    SincInterpolator();
+
+    // Evaluates the band limited signal behind data[0 .. size) at
+    // outCount points start, start + step, ... given in sample units.
+    // Only the samples under the requested span are touched, so the cost
+    // follows outCount (the plot width), not the record length.
+    void resample(const double *data, int size, double start, double step, int outCount, double *out) const;
+
+private:
+    // kPhases rows of kTaps taps, row p is the kernel shifted by p / kPhases
+    std::vector<double> taps;
+};
+
+#endif // SINCINTERPOLATOR_H
@@ -0,0 +1,113 @@
+//******** spectrogram.cpp
+#include "spectrogram.h"
+#include <QColor>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+
+static constexpr int kLevels = 256;
+
+Spectrogram::Spectrogram() {
+    configure(1024, 256);
+}
+
+void Spectrogram::configure(int fftSize, int hop) {
+    size = Fft::nextPowerOfTwo(std::max(fftSize, 16));
+    this->hop = std::clamp(hop, 1, size);
+    fft.reset(new Fft(size));
+    buffer.resize(size);
+
+    window.resize(size);
+    double gain = 0.0;
+    for (int i = 0; i < size; ++i) {
+        window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * M_PI * i / size));
+        gain += window[i];
+    }
+    // a full scale sine (amplitude 128) reads 0 dBFS
+    reference = 128.0 * gain / 2.0;
+
+    waterfall = QImage(bins(), kRows, QImage::Format_Indexed8);
+    updateColorTable();
+    reset();
+}
+
+void Spectrogram::reset() {
+    pending.clear();
+    start = 0;
+    waterfall.fill(0);
+    row = 0;
+    rows = 0;
+}
+
+// --------------------------------------------- STREAM
+
+void Spectrogram::feed(const qint8 *samples, int count) {
+    pending.insert(pending.end(), samples, samples + count);
+
+    while (pending.size() - start >= static_cast<size_t>(size)) {
+        transformRow(pending.data() + start);
+        start += hop;
+    }
+
+    // drop what has been consumed once it outweighs what is left, so the
+    // buffer stays within a few FFT sizes and the move is amortised
+    if (start > pending.size() - start) {
+        pending.erase(pending.begin(), pending.begin() + start);
+        start = 0;
+    }
+}
+
+void Spectrogram::transformRow(const float *block) {
+    for (int i = 0; i < size; ++i) {
+        buffer[i] = Complex(block[i] * window[i], 0.0f);
+    }
+    fft->forward(buffer.data());
+
+    // the ring grows upwards, the newest row sits above the one before it
+    row = row == 0 ? kRows - 1 : row - 1;
+    rows++;
+
+    uchar *line = waterfall.scanLine(row);
+    const double scale = 1.0 / (reference * reference);
+    for (int bin = 0; bin < bins(); ++bin) {
+        const double power = std::norm(buffer[bin]) * scale;
+        const double db = 10.0 * std::log10(power + 1e-20);
+        line[bin] = static_cast<uchar>(std::clamp(static_cast<int>(std::lround((db - kFloorDb) / kDbStep)), 0, kLevels - 1));
+    }
+}
+
+// --------------------------------------------- DISPLAY
+
+void Spectrogram::setColormap(Colormap colormap) {
+    map = colormap;
+    updateColorTable();
+}
+
+void Spectrogram::setRange(double floorDb, double topDb) {
+    floor = std::min(floorDb, topDb - kDbStep);
+    top = topDb;
+    updateColorTable();
+}
+
+void Spectrogram::updateColorTable() {
+    QVector<QRgb> table(kLevels);
+    for (int level = 0; level < kLevels; ++level) {
+        const double db = kFloorDb + level * kDbStep;
+        const double t = std::clamp((db - floor) / (top - floor), 0.0, 1.0);
+        switch (map) {
+        case Colormap::Grey:
+            table[level] = qRgb(t * 255, t * 255, t * 255);
+            break;
+        case Colormap::Heat:
+            // black, red, yellow, white
+            table[level] = qRgb(std::clamp(t * 3.0, 0.0, 1.0) * 255,
+                                std::clamp(t * 3.0 - 1.0, 0.0, 1.0) * 255,
+                                std::clamp(t * 3.0 - 2.0, 0.0, 1.0) * 255);
+            break;
+        case Colormap::Rainbow:
+            table[level] = t == 0.0 ? qRgb(0, 0, 0) : QColor::fromHsvF((1.0 - t) * 240.0 / 360.0, 1.0, 1.0).rgb();
+            break;
+        }
+    }
+    waterfall.setColorTable(table);
+}
@@ -0,0 +1,70 @@
+//******** spectrogram.h
+#ifndef SPECTROGRAM_H
+#define SPECTROGRAM_H
+
+#include <QImage>
+#include <memory>
+#include <vector>
+#include "fft.h"
+
+// Waterfall of the sample stream. Every hop samples a Hann windowed FFT of
+// the last fftSize samples becomes one row of an 8 bit indexed image. The
+// rows form a ring, a new one overwrites the oldest and nothing else is
+// touched, so the cost per row is one FFT and one scan line. Pixels hold
+// the level in kDbStep steps rather than a colour: colormap and dB range
+// live only in the colour table, and changing them repaints the whole
+// history without recomputing a single row.
+class Spectrogram {
+public:
+    enum class Colormap {Grey, Heat, Rainbow};
+
+    static constexpr int kRows = 512;
+    static constexpr double kDbStep = 0.5;
+    static constexpr double kFloorDb = -127.5; // level 0, level 255 is 0 dBFS
+
+    Spectrogram();
+
+    // hop is the distance between FFT starts, fftSize / 4 is 75 % overlap
+    void configure(int fftSize, int hop);
+    void reset();
+
+    void feed(const qint8 *samples, int count);
+
+    int fftSize() const { return size; }
+    int hopSize() const { return hop; }
+    int bins() const { return size / 2; }
+    quint64 rowsWritten() const { return rows; }
+
+    // the newest row is newestRow(), older ones follow it downwards and
+    // wrap around from the bottom to the top of image()
+    const QImage &image() const { return waterfall; }
+    int newestRow() const { return row; }
+
+    void setColormap(Colormap colormap);
+    void setRange(double floorDb, double topDb);
+
+private:
+    void transformRow(const float *block);
+    void updateColorTable();
+
+    int size = 0;
+    int hop = 0;
+    std::unique_ptr<Fft> fft;
+    std::vector<float> window;
+    std::vector<Complex> buffer;
+    double reference = 1.0;
+
+    // samples not consumed by a full FFT yet, start is the oldest
+    std::vector<float> pending;
+    size_t start = 0;
+
+    QImage waterfall;
+    int row = 0;
+    quint64 rows = 0;
+
+    Colormap map = Colormap::Heat;
+    double floor = -100.0;
+    double top = 0.0;
+};
+
+#endif // SPECTROGRAM_H
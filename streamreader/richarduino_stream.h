@@ -0,0 +1,290 @@
+//******** richarduino_stream.h
+#ifndef RICHARDUINO_STREAM_H
+#define RICHARDUINO_STREAM_H
+
+// Reader for the live sample stream Richarduino Host publishes in shared
+// memory. Header only, no Qt, C++11 or later. Copy this file next to your
+// tool, it is the reference for the layout below.
+//
+// The segment is named "/richarduino_stream" (POSIX shm, /dev/shm on Linux)
+// or "Local\richarduino_stream" (Windows file mapping) and looks like
+//
+//   offset  size  field
+//   0       8     magic "RDSTREAM"
+//   8       4     version (1)
+//   12      4     header size, offset of the first ring (192)
+//   16      4     capacity, samples per channel ring, a power of two
+//   20      2     channel count
+//   22      2     sample format (1 = signed 8 bit)
+//   24      4     sample rate in Hz, may change while streaming
+//   28      4     closed, set to 1 when the host stops sharing this segment
+//   32      32    reserved (0)
+//   64      16    channel 0 cursor: u64 begin, u64 end
+//   128     16    channel 1 cursor: u64 begin, u64 end
+//   192           channel 0 ring, then channel 1 ring, capacity bytes each
+//
+// All fields are little endian. Cursors count samples since the stream was
+// created. Sample n of channel c lives at ring c offset n & (capacity - 1)
+// and is valid while n >= begin - capacity and n < end. The writer moves
+// begin before it overwrites a region and end after it has written it, so
+// a reader checks begin again after using the data: if it has moved past
+// the reader's position + capacity, the data was overwritten meanwhile.
+//
+// Readers map the segment read only and never write to it, so any number
+// of them can attach and none of them can hold up acquisition. A reader
+// that falls more than a ring behind loses samples and is told how many.
+//
+// Turning Share off sets closed and unlinks the name; turning it on again
+// creates a new segment under the same name, which a reader still mapping
+// the old one would never see. So a reader that finds closed set lets go
+// and opens the name again, which succeeds once the host shares again, and
+// starts at the new segment's live edge. On Windows a mapping still held
+// by a reader is reused instead: the host clears closed and the cursors go
+// back to 0, readers see end drop below their position and start over from
+// the live edge. StreamReader and the Python reader do both on their own.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace richarduino {
+
+#ifdef _WIN32
+constexpr char kStreamName[] = "Local\\richarduino_stream";
+#else
+constexpr char kStreamName[] = "/richarduino_stream";
+#endif
+constexpr char kStreamMagic[8] = {'R', 'D', 'S', 'T', 'R', 'E', 'A', 'M'};
+constexpr uint32_t kStreamVersion = 1;
+constexpr uint16_t kStreamFormatInt8 = 1;
+constexpr int kStreamMaxChannels = 2;
+
+struct alignas(64) StreamCursor {
+    std::atomic<uint64_t> begin;
+    std::atomic<uint64_t> end;
+};
+
+struct StreamHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t capacity;
+    uint16_t channelCount;
+    uint16_t sampleFormat;
+    std::atomic<uint32_t> sampleRate;
+    std::atomic<uint32_t> closed;
+    uint32_t reserved[8];
+    StreamCursor cursor[kStreamMaxChannels]; // one cache line each
+};
+
+static_assert(sizeof(StreamHeader) == 192, "shared stream header layout changed");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "cursors must be lock free to be shared between processes");
+
+class StreamReader {
+public:
+    // Up to two pieces when the requested range wraps around the ring.
+    // The pointers go straight into shared memory.
+    struct View {
+        const int8_t *first = nullptr;
+        size_t firstCount = 0;
+        const int8_t *second = nullptr;
+        size_t secondCount = 0;
+        uint64_t position = 0;
+
+        size_t size() const { return firstCount + secondCount; }
+    };
+
+    StreamReader() = default;
+    StreamReader(const StreamReader &) = delete;
+    StreamReader &operator=(const StreamReader &) = delete;
+    ~StreamReader() { close(); }
+
+    // attaches to the stream and starts every channel at the live edge
+    bool open(const char *name = kStreamName) {
+        streamName = name;
+        return attach();
+    }
+
+    // True while attached to a live stream. One the host has closed is let
+    // go of and the name opened again; peek() calls this, so a reader
+    // follows Share being turned off and on without doing anything.
+    bool attached() {
+        if (base && header()->closed.load(std::memory_order_acquire) == 0) {
+            return true;
+        }
+        return !streamName.empty() && attach();
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (base) {
+            UnmapViewOfFile(base);
+        }
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        mapping = nullptr;
+#else
+        if (base) {
+            munmap(const_cast<uint8_t *>(base), mappedSize);
+        }
+#endif
+        base = nullptr;
+        mappedSize = 0;
+    }
+
+    bool isOpen() const { return base != nullptr; }
+    const StreamHeader *header() const { return reinterpret_cast<const StreamHeader *>(base); }
+    int channelCount() const { return header()->channelCount; }
+    uint32_t sampleRate() const { return header()->sampleRate.load(std::memory_order_relaxed); }
+
+    // samples this reader skipped because it fell behind or was overwritten
+    uint64_t lostSamples(int channel) const { return lost[channel]; }
+
+    void seekToLatest(int channel) {
+        position[channel] = header()->cursor[channel].end.load(std::memory_order_acquire);
+    }
+
+    // Zero copy view of up to maxSamples unread samples, empty while the
+    // host is not sharing. Call release() when done with it; until then
+    // the writer may overwrite it.
+    View peek(int channel, size_t maxSamples) {
+        if (!attached()) {
+            return View();
+        }
+        const StreamHeader *h = header();
+        const uint64_t capacity = h->capacity;
+        const uint64_t end = h->cursor[channel].end.load(std::memory_order_acquire);
+        const uint64_t begin = h->cursor[channel].begin.load(std::memory_order_relaxed);
+        uint64_t &pos = position[channel];
+
+        if (end < pos) {
+            pos = end; // stream restarted
+        }
+        // fell behind, jump to the oldest sample the writer is not about to reuse
+        if (begin > capacity && pos < begin - capacity) {
+            lost[channel] += begin - capacity - pos;
+            pos = begin - capacity;
+        }
+
+        View view;
+        view.position = pos;
+        size_t count = static_cast<size_t>(end - pos);
+        if (count > maxSamples) {
+            count = maxSamples;
+        }
+        const int8_t *ring = reinterpret_cast<const int8_t *>(base + h->headerSize) + channel * capacity;
+        const size_t offset = static_cast<size_t>(pos & (capacity - 1));
+        view.first = ring + offset;
+        view.firstCount = count < capacity - offset ? count : static_cast<size_t>(capacity - offset);
+        view.second = ring;
+        view.secondCount = count - view.firstCount;
+        return view;
+    }
+
+    // Consumes a view. Returns false if the writer overwrote part of it
+    // while it was in use, in which case its contents must be discarded.
+    bool release(int channel, const View &view) {
+        if (!base || !view.first) {
+            return false; // not attached when it was taken
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t begin = header()->cursor[channel].begin.load(std::memory_order_relaxed);
+        uint64_t &pos = position[channel];
+        pos = view.position + view.size();
+        if (begin > header()->capacity && view.position < begin - header()->capacity) {
+            lost[channel] += view.size();
+            return false;
+        }
+        return true;
+    }
+
+    // copying convenience over peek()/release(), returns the samples copied
+    size_t read(int channel, int8_t *dst, size_t maxSamples) {
+        const View view = peek(channel, maxSamples);
+        if (!view.first) {
+            return 0;
+        }
+        std::memcpy(dst, view.first, view.firstCount);
+        std::memcpy(dst + view.firstCount, view.second, view.secondCount);
+        return release(channel, view) ? view.size() : 0;
+    }
+
+private:
+    bool attach() {
+        const char *name = streamName.c_str();
+        close();
+#ifdef _WIN32
+        mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+        if (!mapping) {
+            return false;
+        }
+        base = static_cast<const uint8_t *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!base) {
+            close();
+            return false;
+        }
+        MEMORY_BASIC_INFORMATION info;
+        VirtualQuery(base, &info, sizeof(info));
+        mappedSize = info.RegionSize;
+#else
+        const int fd = shm_open(name, O_RDONLY, 0);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(StreamHeader))) {
+            ::close(fd);
+            return false;
+        }
+        mappedSize = static_cast<size_t>(st.st_size);
+        void *address = mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd); // the mapping keeps the segment alive
+        if (address == MAP_FAILED) {
+            return false;
+        }
+        base = static_cast<const uint8_t *>(address);
+#endif
+        const StreamHeader *h = header();
+        if (std::memcmp(h->magic, kStreamMagic, sizeof(kStreamMagic)) != 0 || h->version != kStreamVersion
+            || h->channelCount < 1 || h->channelCount > kStreamMaxChannels
+            || (h->capacity & (h->capacity - 1)) != 0
+            || h->headerSize + static_cast<size_t>(h->capacity) * h->channelCount > mappedSize
+            || h->closed.load(std::memory_order_acquire) != 0) {
+            close();
+            return false;
+        }
+        for (int c = 0; c < kStreamMaxChannels; ++c) {
+            seekToLatest(c);
+            lost[c] = 0;
+        }
+        return true;
+    }
+
+    const uint8_t *base = nullptr;
+    std::string streamName;
+    size_t mappedSize = 0;
+#ifdef _WIN32
+    HANDLE mapping = nullptr;
+#endif
+    uint64_t position[kStreamMaxChannels] = {};
+    uint64_t lost[kStreamMaxChannels] = {};
+};
+
+} // namespace richarduino
+
+#endif // RICHARDUINO_STREAM_H
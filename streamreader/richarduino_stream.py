@@ -0,0 +1,138 @@
+#******** richarduino_stream.py
+"""Reader for the live sample stream Richarduino Host publishes in shared
+memory. Standard library only. The layout is documented in
+richarduino_stream.h next to this file.
+
+    from richarduino_stream import StreamReader
+
+    with StreamReader() as stream:
+        while True:
+            samples = stream.read(0)   # bytes of signed 8 bit samples
+            ...
+"""
+
+import mmap
+import os
+import struct
+import sys
+
+STREAM_MAGIC = b"RDSTREAM"
+STREAM_VERSION = 1
+HEADER_SIZE = 192
+CURSOR_OFFSETS = (64, 128)
+
+if sys.platform == "win32":
+    STREAM_NAME = "Local\\richarduino_stream"
+else:
+    STREAM_NAME = "/richarduino_stream"
+
+
+class StreamReader:
+    def __init__(self, name=STREAM_NAME):
+        self._name = name
+        self._map = None
+        self._attach()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def close(self):
+        if self._map is not None:
+            self._view.release()
+            self._map.close()
+            self._map = None
+
+    def _attach(self):
+        """Maps the stream and starts every channel at the live edge."""
+        self.close()
+        stream = _map_stream(self._name)
+        magic, version, header_size, capacity, channels, fmt = struct.unpack_from("<8sIIIHH", stream, 0)
+        if magic != STREAM_MAGIC or version != STREAM_VERSION or struct.unpack_from("<I", stream, 28)[0]:
+            stream.close()
+            raise RuntimeError("not a live Richarduino stream, or an unsupported version")
+        self._map = stream
+        self.capacity = capacity
+        self.channel_count = channels
+        self._rings = [header_size + c * capacity for c in range(channels)]
+        self._view = memoryview(self._map)
+        self._position = [self._cursor(c)[1] for c in range(channels)]
+        self.lost = [0] * channels
+
+    @property
+    def attached(self):
+        """True while attached to a live stream. One the host has closed is
+        let go of and the name opened again, see richarduino_stream.h."""
+        if self._map is not None and not struct.unpack_from("<I", self._map, 28)[0]:
+            return True
+        try:
+            self._attach()
+        except (OSError, RuntimeError, ValueError):
+            return False
+        return True
+
+    @property
+    def sample_rate(self):
+        return struct.unpack_from("<I", self._map, 24)[0] if self._map is not None else 0
+
+    def _cursor(self, channel):
+        return struct.unpack_from("<QQ", self._map, CURSOR_OFFSETS[channel])
+
+    def peek(self, channel, max_samples=1 << 20):
+        """Zero copy view of unread samples as (position, [memoryview, ...]),
+        (None, []) while the host is not sharing. Pass the result to
+        release() once done with it."""
+        if not self.attached:
+            return None, []
+        begin, end = self._cursor(channel)
+        pos = self._position[channel]
+        if end < pos:
+            pos = end  # stream restarted
+        if begin > self.capacity and pos < begin - self.capacity:
+            self.lost[channel] += begin - self.capacity - pos
+            pos = begin - self.capacity
+
+        count = min(end - pos, max_samples)
+        ring = self._rings[channel]
+        offset = pos & (self.capacity - 1)
+        first = min(count, self.capacity - offset)
+        parts = [self._view[ring + offset:ring + offset + first]]
+        if count > first:
+            parts.append(self._view[ring:ring + count - first])
+        return pos, parts
+
+    def release(self, channel, peeked):
+        """False if the writer overwrote the peeked samples meanwhile."""
+        pos, parts = peeked
+        if pos is None or self._map is None:
+            return False  # not attached when it was peeked
+        size = sum(len(p) for p in parts)
+        self._position[channel] = pos + size
+        begin = self._cursor(channel)[0]
+        if begin > self.capacity and pos < begin - self.capacity:
+            self.lost[channel] += size
+            return False
+        return True
+
+    def read(self, channel, max_samples=1 << 20):
+        """Copies out the unread samples, empty if there are none."""
+        peeked = self.peek(channel, max_samples)
+        data = b"".join(bytes(p) for p in peeked[1])
+        return data if self.release(channel, peeked) else b""
+
+
+def _map_stream(name):
+    if sys.platform == "win32":
+        # the size is only known after reading the header
+        probe = mmap.mmap(-1, HEADER_SIZE, tagname=name, access=mmap.ACCESS_READ)
+        capacity, channels = struct.unpack_from("<IH", probe, 16)
+        probe.close()
+        return mmap.mmap(-1, HEADER_SIZE + capacity * channels, tagname=name, access=mmap.ACCESS_READ)
+
+    fd = os.open("/dev/shm" + name, os.O_RDONLY)
+    try:
+        return mmap.mmap(fd, 0, mmap.MAP_SHARED, mmap.PROT_READ)
+    finally:
+        os.close(fd)
@@ -0,0 +1,103 @@
+//******** triggerslicer.h
+#ifndef TRIGGERSLICER_H
+#define TRIGGERSLICER_H
+
+#include <QtGlobal>
+#include <algorithm>
+#include <vector>
+
+// Cuts the continuous sample stream into triggered frames of a fixed
+// length, the way a scope does in normal trigger mode. A frame starts
+// pretrigger samples before an edge through level and the next edge is
+// looked for only after the frame has ended, so frames never overlap.
+// Hysteresis keeps noise around the level from re-arming the trigger.
+class TriggerSlicer {
+public:
+    enum class Edge {Rising, Falling};
+
+    void configure(int level, Edge edge, int frameLength, int pretrigger, int hysteresis = 2) {
+        this->level = level;
+        this->edge = edge;
+        length = std::max(frameLength, 1);
+        pre = std::min(std::max(pretrigger, 0), length - 1);
+        this->hysteresis = std::max(hysteresis, 0);
+        reset();
+    }
+
+    void reset() {
+        history.clear();
+        scan = 0;
+        armed = false;
+        triggers = 0;
+    }
+
+    int frameLength() const { return length; }
+    quint64 triggerCount() const { return triggers; }
+
+    // Feeds the next block of channel samples. sink(frame) is called with a
+    // pointer to frameLength() contiguous samples for every complete frame.
+    template <typename Sink>
+    void feed(const qint8 *samples, int count, Sink &&sink);
+
+private:
+    std::vector<qint8> history; // unconsumed tail of the stream, starts pre samples before scan
+    size_t scan = 0;            // next sample in history to look for an edge at
+    bool armed = false;
+    quint64 triggers = 0;
+
+    int level = 0;
+    Edge edge = Edge::Rising;
+    int length = 512;
+    int pre = 128;
+    int hysteresis = 2;
+};
+
+template <typename Sink>
+void TriggerSlicer::feed(const qint8 *samples, int count, Sink &&sink) {
+    history.insert(history.end(), samples, samples + count);
+
+    // a falling edge is a rising edge of the negated signal
+    const int sign = edge == Edge::Rising ? 1 : -1;
+    const int arm = sign * level - hysteresis;
+    const int fire = sign * level;
+
+    const size_t size = history.size();
+    while (scan < size) {
+        const int value = sign * history[scan];
+        if (!armed) {
+            armed = value < arm;
+            scan++;
+            continue;
+        }
+        if (value < fire) {
+            scan++;
+            continue;
+        }
+
+        // edge at scan, wait until the whole frame is in
+        if (scan < static_cast<size_t>(pre)) {
+            // not enough history before the very first edge, skip it
+            armed = false;
+            scan++;
+            continue;
+        }
+        const size_t start = scan - pre;
+        if (start + length > size) {
+            break;
+        }
+
+        triggers++;
+        sink(history.data() + start);
+        scan = start + length;
+        armed = false;
+    }
+
+    // keep only what the next edge can still need for its pretrigger
+    const size_t keep = scan > static_cast<size_t>(pre) ? scan - pre : 0;
+    if (keep > 0) {
+        history.erase(history.begin(), history.begin() + keep);
+        scan -= keep;
+    }
+}
+
+#endif // TRIGGERSLICER_H
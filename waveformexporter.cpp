@@ -0,0 +1,200 @@
+//******** waveformexporter.cpp
+#include "waveformexporter.h"
+#include "capturefile.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QtEndian>
+#include <vector>
+#include <cstring>
+
+// frames converted and written per pass, bounds memory regardless of capture size
+static constexpr qint64 kChunkFrames = 64 * 1024;
+
+WaveformExporter::WaveformExporter(QObject *parent) : QObject(parent) {}
+
+ExportFormat WaveformExporter::formatForFile(const QString &path) {
+    QString suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "wav") {
+        return ExportFormat::Wav;
+    }
+    if (suffix == "rcap" || suffix == "bin") {
+        return ExportFormat::Binary;
+    }
+    return ExportFormat::Csv;
+}
+
+void WaveformExporter::exportFrame(const QVector<double> &channel1, const QVector<double> &channel2, quint32 sampleRate, const QString &path) {
+    // the second channel is only exported when it carries data
+    const bool dual = !channel2.isEmpty();
+    const quint16 channels = dual ? 2 : 1;
+    const qint64 frameCount = dual ? std::min(channel1.size(), channel2.size()) : channel1.size();
+
+    qint64 position = 0;
+    auto reader = [&](double *dst, qint64 maxFrames) {
+        qint64 count = std::min(maxFrames, frameCount - position);
+        for (qint64 i = 0; i < count; ++i) {
+            dst[i * channels] = channel1[position + i];
+            if (dual) {
+                dst[i * channels + 1] = channel2[position + i];
+            }
+        }
+        position += count;
+        return count;
+    };
+
+    if (writeStream(reader, frameCount, channels, sampleRate, path)) {
+        emit finished(true, "Exported " + QString::number(frameCount) + " samples to " + path);
+    }
+}
+
+void WaveformExporter::exportCapture(const QString &capturePath, const QString &path) {
+    CaptureReader capture;
+    if (!capture.open(capturePath)) {
+        emit finished(false, "ERROR: cannot open capture " + capturePath + ". " + capture.errorString());
+        return;
+    }
+
+    const quint16 channels = capture.channelCount();
+    const qint64 frameCount = capture.sampleCount() / channels;
+
+    std::vector<char> raw(kChunkFrames * channels);
+    auto reader = [&](double *dst, qint64 maxFrames) {
+        qint64 count = capture.read(raw.data(), std::min<qint64>(maxFrames, kChunkFrames) * channels) / channels;
+        for (qint64 i = 0; i < count * channels; ++i) {
+            dst[i] = static_cast<int8_t>(raw[i]);
+        }
+        return count;
+    };
+
+    if (writeStream(reader, frameCount, channels, capture.sampleRate(), path)) {
+        emit finished(true, "Exported " + QString::number(frameCount) + " samples from " + capturePath + " to " + path);
+    }
+}
+
+bool WaveformExporter::writeStream(const ChunkReader &reader, qint64 frameCount, quint16 channels, quint32 sampleRate, const QString &path) {
+    const ExportFormat format = formatForFile(path);
+
+    QFile out(path);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        emit finished(false, "ERROR: cannot open " + path + ". " + out.errorString());
+        return false;
+    }
+
+    // 1 ----------------------------- header ----------------------------
+    QByteArray header;
+    if (format == ExportFormat::Csv) {
+        header = "time_s";
+        for (int c = 1; c <= channels; ++c) {
+            header += ",ch" + QByteArray::number(c);
+        }
+        header += '\n';
+    } else if (format == ExportFormat::Wav) {
+        // canonical 44 byte header for 16 bit PCM, the sizes are patched in
+        // once the samples are written
+        const quint32 dataBytes = 0;
+        header.resize(44);
+        uchar *h = reinterpret_cast<uchar *>(header.data());
+        memcpy(h, "RIFF", 4);
+        qToLittleEndian<quint32>(36 + dataBytes, h + 4);
+        memcpy(h + 8, "WAVEfmt ", 8);
+        qToLittleEndian<quint32>(16, h + 16);
+        qToLittleEndian<quint16>(1, h + 20); // PCM
+        qToLittleEndian<quint16>(channels, h + 22);
+        qToLittleEndian<quint32>(sampleRate, h + 24);
+        qToLittleEndian<quint32>(sampleRate * channels * 2, h + 28);
+        qToLittleEndian<quint16>(channels * 2, h + 32);
+        qToLittleEndian<quint16>(16, h + 34);
+        memcpy(h + 36, "data", 4);
+        qToLittleEndian<quint32>(dataBytes, h + 40);
+    } else {
+        header.resize(kCaptureHeaderSize);
+        uchar *h = reinterpret_cast<uchar *>(header.data());
+        memcpy(h, "RCAP", 4);
+        qToLittleEndian<quint16>(kCaptureVersion, h + 4);
+        qToLittleEndian<quint16>(channels, h + 6);
+        qToLittleEndian<quint32>(sampleRate, h + 8);
+        qToLittleEndian<quint32>(0, h + 12);
+    }
+    out.write(header);
+
+    // 2 ----------------------------- samples, one chunk at a time ----------------------------
+    std::vector<double> samples(kChunkFrames * channels);
+    QByteArray chunk;
+    qint64 done = 0;
+    const double timeStep = sampleRate > 0 ? 1.0 / sampleRate : 0.0;
+
+    while (done < frameCount) {
+        if (cancelRequested) {
+            out.remove();
+            emit finished(false, "Export cancelled");
+            return false;
+        }
+
+        qint64 count = reader(samples.data(), std::min(kChunkFrames, frameCount - done));
+        if (count <= 0) {
+            break; // source ended early, reported below
+        }
+
+        chunk.clear();
+        const qint64 values = count * channels;
+        if (format == ExportFormat::Csv) {
+            for (qint64 i = 0; i < count; ++i) {
+                chunk += QByteArray::number((done + i) * timeStep, 'g', 9);
+                for (int c = 0; c < channels; ++c) {
+                    chunk += ',';
+                    chunk += QByteArray::number(samples[i * channels + c], 'g', 6);
+                }
+                chunk += '\n';
+            }
+        } else if (format == ExportFormat::Wav) {
+            chunk.resize(values * 2);
+            uchar *p = reinterpret_cast<uchar *>(chunk.data());
+            for (qint64 i = 0; i < values; ++i) {
+                // 8 bit ADC codes sit in the high byte of the 16 bit sample
+                int value = qBound(-32768, qRound(samples[i] * 256.0), 32767);
+                qToLittleEndian<qint16>(static_cast<qint16>(value), p + i * 2);
+            }
+        } else {
+            chunk.resize(values);
+            char *p = chunk.data();
+            for (qint64 i = 0; i < values; ++i) {
+                p[i] = static_cast<char>(qBound(-128, qRound(samples[i]), 127));
+            }
+        }
+
+        if (out.write(chunk) != chunk.size()) {
+            QString error = out.errorString();
+            out.remove();
+            emit finished(false, "ERROR: write failed for " + path + ". " + error);
+            return false;
+        }
+
+        done += count;
+        emit progress(done, frameCount);
+    }
+
+    // 3 ----------------------------- sizes of what was actually written ----------------------------
+    if (format == ExportFormat::Wav) {
+        const quint32 dataBytes = static_cast<quint32>(done * channels * 2);
+        uchar size[4];
+        qToLittleEndian<quint32>(36 + dataBytes, size);
+        bool patched = out.seek(4) && out.write(reinterpret_cast<char *>(size), 4) == 4;
+        qToLittleEndian<quint32>(dataBytes, size);
+        patched = patched && out.seek(40) && out.write(reinterpret_cast<char *>(size), 4) == 4;
+        if (!patched) {
+            QString error = out.errorString();
+            out.remove();
+            emit finished(false, "ERROR: write failed for " + path + ". " + error);
+            return false;
+        }
+    }
+    out.close();
+
+    // the file is valid but incomplete
+    if (done < frameCount) {
+        emit finished(false, QString("ERROR: the source ended after %1 of %2 samples, %3 is incomplete")
+                                 .arg(done).arg(frameCount).arg(path));
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,51 @@
+//******** waveformexporter.h
+#ifndef WAVEFORMEXPORTER_H
+#define WAVEFORMEXPORTER_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <functional>
+
+enum class ExportFormat {
+    Csv,
+    Wav,
+    Binary
+};
+
+// Writes waveforms to disk. Lives on its own thread; the public slots are
+// meant to be invoked queued and stream the output in fixed size chunks so
+// a capture never has to fit in memory.
+class WaveformExporter : public QObject {
+    Q_OBJECT
+
+public:
+    explicit WaveformExporter(QObject *parent = nullptr);
+
+    static ExportFormat formatForFile(const QString &path);
+
+    // safe to call from any thread, the running export stops at the next
+    // chunk; queued() is called as a job is queued and clears an old cancel,
+    // so a cancel issued before the job starts still stops it
+    void cancel() { cancelRequested = true; }
+    void queued() { cancelRequested = false; }
+
+public slots:
+    void exportFrame(const QVector<double> &channel1, const QVector<double> &channel2, quint32 sampleRate, const QString &path);
+    void exportCapture(const QString &capturePath, const QString &path);
+
+signals:
+    void progress(qint64 done, qint64 total);
+    void finished(bool ok, const QString &message);
+
+private:
+    // fills dst with up to maxFrames interleaved frames, returns frames read
+    using ChunkReader = std::function<qint64(double *dst, qint64 maxFrames)>;
+
+    bool writeStream(const ChunkReader &reader, qint64 frameCount, quint16 channels, quint32 sampleRate, const QString &path);
+
+    std::atomic<bool> cancelRequested{false};
+};
+
+#endif // WAVEFORMEXPORTER_H